@@ -1,7 +1,6 @@
 //http://www.zentut.com/c-tutorial/c-avl-tree/
 
 #include <string.h> //memcpy
-#include <stdlib.h> //malloc
 
 #include "IO_RTC.h"
 #include "IO_Driver.h"
@@ -251,30 +250,22 @@ return root;
 insert a new node into the tree
 */
 //AVLNode* AVL_insert(AVLNode* t, ubyte4 messageID, ubyte1 messageData[8], ubyte4 minTime, ubyte4 maxTime, bool req)
-AVLNode* AVL_insert(AVLNode** messageHistoryArray, ubyte4 messageID, ubyte1 messageData[8], ubyte4 minTime, ubyte4 maxTime, bool req)
+AVLNode* AVL_insert(AVLNode* message, ubyte1 messageData[8], ubyte4 minTime, ubyte4 maxTime, bool req)
 {
     //This function has been hijacked for an emergency quick fix
+    //Nodes now come from the caller's static pool (see CanManager) - no malloc
+
+    message->timeBetweenMessages_Min = minTime;
+    message->timeBetweenMessages_Max = maxTime;
+    IO_RTC_StartTime(&message->lastMessage_timeStamp);
+
+    //To copy an entire array, http://stackoverflow.com/questions/9262784/array-equal-another-array
+    memcpy(message->data, messageData, 8);
+
+    message->required = req;
+    message->lastSourceUpdateCount = 0;
+    message->pendingSourceUpdateCount = 0;
 
-    AVLNode* message = (AVLNode*)malloc(sizeof(AVLNode));
-    if (message == NULL) //malloc failed
-    {
-        //fprintf(stderr, "Out of memory!!! (insert)\n");
-        //exit(1);
-    }
-    else
-    {
-        //message->id = messageID;
-        message->timeBetweenMessages_Min = minTime;
-        message->timeBetweenMessages_Max = maxTime;
-        IO_RTC_StartTime(&message->lastMessage_timeStamp);
-
-        //To copy an entire array, http://stackoverflow.com/questions/9262784/array-equal-another-array
-        memcpy(messageData, message->data, sizeof(messageData));
-
-        message->required = req;
-
-        messageHistoryArray[messageID] = message;
-    }
     return message;
 
     ////ACTUAL AVL INSERT CODE BELOW
@@ -19,6 +19,10 @@ typedef struct AVLNode
     bool required;
     ubyte4 timeBetweenMessages_Max;  //Slowest rate at which messages will be sent, OR max time between receiving messages before throwing an error
 
+    //Outgoing telemetry only: source object's update count when this message was last sent (see CanManager_frameNeeded)
+    ubyte2 lastSourceUpdateCount;
+    ubyte2 pendingSourceUpdateCount;
+
 	//Tree stuff -----------------------------------------------------
 	//struct AVLNode*  left;
 	//struct AVLNode*  right;
@@ -26,7 +30,7 @@ typedef struct AVLNode
 } AVLNode;
 
 //Note on passing arrays: http://stackoverflow.com/questions/5573310/difference-between-passing-array-and-array-pointer-into-function-in-c
-AVLNode* AVL_insert(AVLNode **t, ubyte4 messageID, ubyte1 messageData[8], ubyte4 timeBetweenMessages_Min, ubyte4 timeBetweenMessages_Max, bool required);
+AVLNode* AVL_insert(AVLNode* message, ubyte1 messageData[8], ubyte4 timeBetweenMessages_Min, ubyte4 timeBetweenMessages_Max, bool required);
 //////////////////AVLNode* AVL_find(AVLNode *t, ubyte4 messageID);
 //int AVL_getData(AVLNode* n);
 //AVLNode* AVL_findMin(AVLNode *t);
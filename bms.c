@@ -1,7 +1,6 @@
 
 #include <stdio.h>
 #include "bms.h"
-#include <stdlib.h>
 #include "IO_Driver.h"
 #include "IO_RTC.h"
 #include "serial.h"
@@ -100,6 +99,8 @@ struct _BatteryManagementSystem {
 
     sbyte4 packVoltage;  //Voltage(100mV)[022]
     sbyte4 packCurrent;  //Current(100mA)[054]
+    sbyte2 packVoltage_dV;  //Unrounded copies (0.1 V / 0.1 A) for power calculations
+    sbyte2 packCurrent_dA;
     sbyte1 maxTemp;      //Max Temp[104]
     sbyte1 avgTemp;      //Avg Temp[096]
     //ubyte1 SOC;          //SOC(%)[112]
@@ -107,32 +108,59 @@ struct _BatteryManagementSystem {
     ubyte1 CCL;          //DO NOT USE
     ubyte1 DCL;          //DO NOT USE
 
+    ubyte2 tempUpdateCount;  //Bumped whenever maxTemp is received (0x627/0x629)
+
+    //chargeLimit/dischargeLimit (A) x pack voltage, recalculated when either arrives
+    bool currentLimitsMessageReceived;  //0x624 seen
+    bool currentLimitsReceived;         //...and a pack voltage to turn them into power
+    sbyte4 chargePowerLimitW;
+    sbyte4 dischargePowerLimitW;
+
     
 
     // signed = 2's complement: 0XfFF = -1, 0x00 = 0, 0x01 = 1
 
 };
 
+static struct _BatteryManagementSystem bmsInstance;
+
 BatteryManagementSystem* BMS_new(SerialManager* serialMan, ubyte2 canMessageBaseID) {
 
-    BatteryManagementSystem* me = (BatteryManagementSystem*)malloc(sizeof(struct _BatteryManagementSystem));
+    BatteryManagementSystem* me = &bmsInstance;
 
     me->canMessageBaseId = canMessageBaseID;
     me->sm = serialMan;
     me->maxTemp = 99;
+    me->tempUpdateCount = 0;
 
     me->packCurrent = 0;
     me->packVoltage = 0;
+    me->packCurrent_dA = 0;
+    me->packVoltage_dV = 0;
 
     me->CCL = 0;
     me->DCL = 0;
     me->chargeLimit = 0;
     me->dischargeLimit = 0;
+    me->currentLimitsMessageReceived = FALSE;
+    me->currentLimitsReceived = FALSE;
+    me->chargePowerLimitW = 0;
+    me->dischargePowerLimitW = 0;
     
     return me;
 
 }
 
+//Current limits -> power limits, so the per-cycle torque ceiling is just one divide by speed
+static void BMS_updatePowerLimits(BatteryManagementSystem* me)
+{
+    me->chargePowerLimitW = (sbyte4)me->chargeLimit * me->packVoltage_dV / 10;
+    me->dischargePowerLimitW = (sbyte4)me->dischargeLimit * me->packVoltage_dV / 10;
+
+    //Limits with no pack voltage yet would be 0 W (no torque at all) - don't use them until both are in
+    me->currentLimitsReceived = (me->currentLimitsMessageReceived == TRUE && me->packVoltage_dV > 0);
+}
+
 void BMS_parseCanMessage(BatteryManagementSystem* bms, IO_CAN_DATA_FRAME* bmsCanMessage){
     ubyte2 utemp16;
 //    sbyte1  temp16;
@@ -175,6 +203,8 @@ void BMS_parseCanMessage(BatteryManagementSystem* bms, IO_CAN_DATA_FRAME* bmsCan
         utemp16 = ((bmsCanMessage->data[4] << 8) | (bmsCanMessage->data[5]));
         bms->dischargeLimit = swap_uint16(utemp16);
 
+        bms->currentLimitsMessageReceived = TRUE;
+        BMS_updatePowerLimits(bms);
         break;
 
     case 0x625:
@@ -213,6 +243,7 @@ void BMS_parseCanMessage(BatteryManagementSystem* bms, IO_CAN_DATA_FRAME* bmsCan
         bms->minTempCell = bmsCanMessage->data[3];
         bms->maxTemp = bmsCanMessage->data[4];
         bms->maxTempCell = bmsCanMessage->data[5];
+        bms->tempUpdateCount++;
 
         break;
 
@@ -246,8 +277,12 @@ void BMS_parseCanMessage(BatteryManagementSystem* bms, IO_CAN_DATA_FRAME* bmsCan
         
         bms->packVoltage = (((bmsCanMessage->data[1] << 8) | (bmsCanMessage->data[0])) / 10); //V
         bms->packCurrent = (((bmsCanMessage->data[3] << 8) | (bmsCanMessage->data[2])) / 10); //V
+        bms->packVoltage_dV = (sbyte2)((ubyte2)bmsCanMessage->data[1] << 8 | bmsCanMessage->data[0]);
+        bms->packCurrent_dA = (sbyte2)((ubyte2)bmsCanMessage->data[3] << 8 | bmsCanMessage->data[2]);
+        BMS_updatePowerLimits(bms);
         bms->maxTemp = ((bmsCanMessage->data[4]));  //C
         bms->avgTemp = ((bmsCanMessage->data[5]));  //C
+        bms->tempUpdateCount++;
         bms->CCL = ((bmsCanMessage->data[6]));    //%
         bms->DCL = ((bmsCanMessage->data[7]));    //%
 
@@ -255,6 +290,21 @@ void BMS_parseCanMessage(BatteryManagementSystem* bms, IO_CAN_DATA_FRAME* bmsCan
     }
 }
 
+ubyte1 BMS_getSOC(BatteryManagementSystem* me)
+{
+    return me->SOC;
+}
+
+ubyte1 BMS_getFaultCode(BatteryManagementSystem* me)
+{
+    return me->faultCode;
+}
+
+ubyte2 BMS_getTempUpdateCount(BatteryManagementSystem* me)
+{
+    return me->tempUpdateCount;
+}
+
 sbyte1 BMS_getAvgTemp(BatteryManagementSystem* me)
 {
     char buffer[32];
@@ -269,11 +319,12 @@ sbyte1 BMS_getMaxTemp(BatteryManagementSystem* me)
 }
 
 // ***NOTE: packCurrent and and packVoltage are SIGNED variables and the return type for BMS_getPower is signed
+//Watts.  Uses the 0.1 V / 0.1 A values so it isn't truncated to whole volts and amps first.
 sbyte4 BMS_getPower(BatteryManagementSystem* me)
 {
     //char buffer[32];
     //sprintf(buffer, "packVoltage: %f\n", me->packVoltage);
-    return (me->packCurrent * me->packVoltage);
+    return ((sbyte4)me->packCurrent_dA * me->packVoltage_dV) / 100;
 }
 
 ubyte2 BMS_getPackTemp(BatteryManagementSystem* me)
@@ -283,18 +334,33 @@ ubyte2 BMS_getPackTemp(BatteryManagementSystem* me)
     return (me->packTemp);
 }
 
-ubyte1 BMS_getCCL(BatteryManagementSystem* me)
+ubyte2 BMS_getCCL(BatteryManagementSystem* me)
 {
     //return me->CCL;
     return me->chargeLimit;
 }
 
-ubyte1 BMS_getDCL(BatteryManagementSystem* me)
+ubyte2 BMS_getDCL(BatteryManagementSystem* me)
 {
     //return me->DCL;
     return me->dischargeLimit;
 }
 
+bool BMS_getCurrentLimitsReceived(BatteryManagementSystem* me)
+{
+    return me->currentLimitsReceived;
+}
+
+sbyte4 BMS_getChargePowerLimitW(BatteryManagementSystem* me)
+{
+    return me->chargePowerLimitW;
+}
+
+sbyte4 BMS_getDischargePowerLimitW(BatteryManagementSystem* me)
+{
+    return me->dischargePowerLimitW;
+}
+
 
 // ELITHION BMS OPTIONS //
 
@@ -38,9 +38,15 @@ sbyte4 BMS_getPower(BatteryManagementSystem* me);
 ubyte2 BMS_getPackTemp(BatteryManagementSystem* me);
 sbyte1 BMS_getAvgTemp(BatteryManagementSystem* me);
 sbyte1 BMS_getMaxTemp(BatteryManagementSystem* me);
-
-ubyte1 BMS_getCCL(BatteryManagementSystem* me);
-ubyte1 BMS_getDCL(BatteryManagementSystem* me);
+ubyte1 BMS_getSOC(BatteryManagementSystem* me);  //Whole % (0x626)
+ubyte1 BMS_getFaultCode(BatteryManagementSystem* me);  //storedFaults (0x622 byte 4), 0 = none
+ubyte2 BMS_getTempUpdateCount(BatteryManagementSystem* me);  //Changes whenever a new max temp arrives
+
+ubyte2 BMS_getCCL(BatteryManagementSystem* me);  //Amps (0x624)
+ubyte2 BMS_getDCL(BatteryManagementSystem* me);
+bool BMS_getCurrentLimitsReceived(BatteryManagementSystem* me);  //FALSE until both 0x624 and a nonzero pack voltage (0x629) have arrived
+sbyte4 BMS_getChargePowerLimitW(BatteryManagementSystem* me);     //CCL x pack voltage
+sbyte4 BMS_getDischargePowerLimitW(BatteryManagementSystem* me);  //DCL x pack voltage
 
 typedef enum
 {
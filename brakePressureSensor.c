@@ -1,4 +1,3 @@
-#include <stdlib.h>  //Needed for malloc
 #include <math.h>
 #include "IO_RTC.h"
 
@@ -9,6 +8,8 @@
 //extern Sensor Sensor_BPS0;
 //extern Sensor Sensor_BenchTPS1;
 
+static struct _BrakePressureSensor brakePressureSensorInstance;
+
 /*****************************************************************************
 * Torque Encoder (TPS) functions
 * RULE EV2.3.5:
@@ -17,7 +18,7 @@
 ****************************************************************************/
 BrakePressureSensor* BrakePressureSensor_new(void)
 {
-    BrakePressureSensor* me = (BrakePressureSensor*)malloc(sizeof(struct _BrakePressureSensor));
+    BrakePressureSensor* me = &brakePressureSensorInstance;
     //me->bench = benchMode;
 
     //TODO: Make sure the main loop is running before doing this
@@ -35,6 +36,7 @@ BrakePressureSensor* BrakePressureSensor_new(void)
     me->percent = 0;
     me->runCalibration = FALSE;  //Do not run the calibration at the next main loop cycle
     me->brakePercentage= 0;
+    me->updateCount = 0;
     //me->calibrated = FALSE;
     BrakePressureSensor_resetCalibration(me);
 
@@ -44,6 +46,12 @@ BrakePressureSensor* BrakePressureSensor_new(void)
 //Updates all values based on sensor readings, safety checks, etc
 void BrakePressureSensor_update(BrakePressureSensor* me, bool bench)
 {
+	//Calibration values change every cycle while calibrating, so count those as updates too
+	if (me->bps0_value != me->bps0->sensorValue || me->runCalibration == TRUE)
+	{
+		me->updateCount++;
+	}
+
 	me->bps0_value = me->bps0->sensorValue;
 	//me->bps1_value = me->bps1->sensorValue;
 
@@ -65,6 +73,11 @@ void BrakePressureSensor_update(BrakePressureSensor* me, bool bench)
     
 }
 
+ubyte2 BrakePressureSensor_getUpdateCount(BrakePressureSensor* me)
+{
+    return me->updateCount;
+}
+
 void BrakePressureSensor_resetCalibration(BrakePressureSensor* me)
 {
     me->calibrated = FALSE;
@@ -35,6 +35,8 @@ typedef struct _BrakePressureSensor
     float4 percent;
 	bool implausibility;
 	ubyte1 brakePercentage;
+
+    ubyte2 updateCount;  //Incremented whenever values reported by this object change (for telemetry)
 } BrakePressureSensor;
 
 BrakePressureSensor* BrakePressureSensor_new(void);
@@ -46,5 +48,6 @@ void BrakePressureSensor_loadCalibrationFromEEPROM(BrakePressureSensor* me);
 void BrakePressureSensor_startCalibration(BrakePressureSensor* me, ubyte1 secondsToRun);
 void BrakePressureSensor_calibrationCycle(BrakePressureSensor* me, ubyte1* errorCount);
 void BrakePressureSensor_getPedalTravel(BrakePressureSensor* me, ubyte1* errorCount, float4* pedalPercent);
+ubyte2 BrakePressureSensor_getUpdateCount(BrakePressureSensor* me);
 
 #endif //  _BRAKEPRESSURESENSOR_H
\ No newline at end of file
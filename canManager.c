@@ -1,6 +1,4 @@
 
-#include <stdlib.h> //malloc
-
 #include "IO_Driver.h" 
 #include "IO_CAN.h"
 #include "IO_RTC.h"
@@ -14,7 +12,43 @@
 #include "safety.h"
 #include "wheelSpeeds.h"
 #include "serial.h"
-
+#include "chassisSensors.h"
+#include "stackMonitor.h"
+#include "latencyTracer.h"
+#include "thermalDerating.h"
+#include "powerLimiter.h"
+#include "energyEstimator.h"
+#include "ecoMode.h"
+#include "launchControl.h"
+#include "freezeFrame.h"
+#include "faultLog.h"
+#include "isoTp.h"
+
+
+//One entry in the receive routing table
+typedef struct _CanHandlerEntry {
+    CanChannel channel;
+    ubyte2 firstID;
+    ubyte2 lastID;
+    CanMessageHandler handler;
+    void* object;
+    ubyte1 fifo;            //Read FIFO its messages arrive in (index into readFifos)
+} CanHandlerEntry;
+
+//One hardware read FIFO.  The acceptance filter (IDs where (id & acceptMask) == acceptID)
+//is worked out from the handlers assigned to it when receiving starts.
+typedef struct _CanReadFifo {
+    CanChannel channel;
+    bool shared;            //Catches every handler on the channel that doesn't have its own FIFO
+    ubyte2 firstID;         //Dedicated FIFOs: handlers inside this range go here
+    ubyte2 lastID;
+    ubyte4 acceptID;
+    ubyte4 acceptMask;
+    ubyte1 size;
+    ubyte1 handle;
+    IO_ErrorType ioErr_init;
+    IO_ErrorType ioErr_read;
+} CanReadFifo;
 
 struct _CanManager {
     //AVLNode* incomingTree;
@@ -29,14 +63,12 @@ struct _CanManager {
     //Functions shall have a CanChannel enum (see header) parameter.  Direction (send/receive is not
     //specified by this parameter.  The CAN0/CAN1 is selected based on the parameter passed in, and 
     //Read/Write is selected based on the function that is being called (get/send)
-    ubyte1 can0_busSpeed;
-    ubyte1 can0_readHandle;
-    ubyte1 can0_read_messageLimit;
+    ubyte2 can0_busSpeed;
+    ubyte1 can0_read_messageLimit;     //Split between the channel's read FIFOs (see CanManager_startReceiving)
     ubyte1 can0_writeHandle;
     ubyte1 can0_write_messageLimit;
 
-    ubyte1 can1_busSpeed;
-    ubyte1 can1_readHandle;
+    ubyte2 can1_busSpeed;
     ubyte1 can1_read_messageLimit;
     ubyte1 can1_writeHandle;
     ubyte1 can1_write_messageLimit;
@@ -56,11 +88,42 @@ struct _CanManager {
 
     ubyte4 sendDelayus;
 
-
-    //WARNING: These values are not initialized - be careful to only access
-    //pointers that have been previously assigned
-    //AVLNode* canMessageHistory[0x7FF];
-    AVLNode* canMessageHistory[0x7FF];
+    //Incoming message routing - see CanManager_addHandler
+    CanHandlerEntry handlers[CAN_HANDLERS_MAX];
+    ubyte1 handlerCount;
+
+    //Read FIFOs - 0 and 1 are the CAN0 and CAN1 shared ones
+    CanReadFifo readFifos[CAN_READ_FIFOS_MAX];
+    ubyte1 readFifoCount;
+    bool receiving;  //FIFOs configured - no more handlers
+
+    //Each registered motor controller gets a dedicated hardware message object for its
+    //command message (0xC0 for the first), not shared with the write FIFO
+    MotorController* mcmCommandOwner[MCM_CONTROLLERS_MAX];
+    ubyte1 can0_mcmCommandHandle[MCM_CONTROLLERS_MAX];
+    IO_ErrorType ioErr_can0_mcmCommand[MCM_CONTROLLERS_MAX];
+    ubyte1 mcmCyclesSinceCommand[MCM_CONTROLLERS_MAX];
+    ubyte1 mcmCount;
+
+    ubyte1 safetyTimingRule;  //Next rule canOutput_sendSafetyRuleTiming reports
+
+    //Outgoing frame buffers - frames are built in place here (CanManager_beginFrame)
+    //and then filtered/compacted in place before going to the FIFO
+    IO_CAN_DATA_FRAME can0_outgoing[CAN_OUTGOING_FRAMES_MAX];
+    ubyte1 can0_outgoingCount;
+    IO_CAN_DATA_FRAME can1_outgoing[CAN_OUTGOING_FRAMES_MAX];
+    ubyte1 can1_outgoingCount;
+    IO_CAN_DATA_FRAME overflowFrame;  //Handed out when a buffer is full so callers never get NULL.  Never sent.
+
+    //Incoming frames (one channel at a time) - also echoed to CAN1 in place
+    IO_CAN_DATA_FRAME readBuffer[CAN_READ_FRAMES_MAX];
+
+    //Message history nodes come from a fixed pool.  canMessageHistoryIndex maps
+    //a message ID to its node (position + 1, 0 = no history yet).
+    AVLNode canMessageHistory[CAN_MESSAGE_HISTORY_MAX];
+    ubyte1 canMessageHistoryCount;
+    ubyte1 canMessageHistoryIndex[0x800];
+    AVLNode canMessageHistoryOverflow;  //Used (and re-initialized every time) once the pool is full
 };
 
 //Keep track of CAN message IDs, their data, and when they were last sent.
@@ -77,11 +140,17 @@ struct _CanMessageNode
 };
 */
 
+static struct _CanManager canManagerInstance;
+
+static AVLNode* CanManager_getHistory(CanManager* me, ubyte2 messageID, bool* firstTimeMessage);
+static void CanManager_setHistory(CanManager* me, ubyte2 messageID, ubyte4 timeBetweenMessages_Min, ubyte4 timeBetweenMessages_Max);
+static bool CanManager_addReadFifo(CanManager* me, CanChannel channel, bool shared, ubyte2 firstID, ubyte2 lastID);
+
 CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit, ubyte1 can0_write_messageLimit
                          , ubyte2 can1_busSpeed, ubyte1 can1_read_messageLimit, ubyte1 can1_write_messageLimit
                          , ubyte4 defaultSendDelayus, SerialManager* serialMan) //ubyte4 defaultMinSendDelay, ubyte4 defaultMaxSendDelay)
 {
-    CanManager* me = (CanManager*)malloc(sizeof(struct _CanManager));
+    CanManager* me = &canManagerInstance;
 
     me->sm = serialMan;
     SerialManager_send(me->sm, "CanManager's reference to SerialManager was created.\n");
@@ -89,13 +158,32 @@ CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit,
     //create can history data structure (AVL tree?)
     //me->incomingTree = NULL;
     //me->outgoingTree = NULL;
-    for (ubyte4 id = 0; id <= 0x7FF; id++)
+    me->canMessageHistoryCount = 0;
+    for (ubyte2 id = 0; id <= 0x7FF; id++)
     {
-        me->canMessageHistory[id] = 0;
+        me->canMessageHistoryIndex[id] = 0;
     }
 
     me->sendDelayus = defaultSendDelayus;
 
+    me->can0_busSpeed = can0_busSpeed;
+    me->can0_read_messageLimit = (can0_read_messageLimit > CAN_READ_FRAMES_MAX) ? CAN_READ_FRAMES_MAX : can0_read_messageLimit;
+    me->can0_write_messageLimit = can0_write_messageLimit;
+    me->can1_busSpeed = can1_busSpeed;
+    me->can1_read_messageLimit = (can1_read_messageLimit > CAN_READ_FRAMES_MAX) ? CAN_READ_FRAMES_MAX : can1_read_messageLimit;
+    me->can1_write_messageLimit = can1_write_messageLimit;
+
+    me->can0_outgoingCount = 0;
+    me->can1_outgoingCount = 0;
+
+    me->handlerCount = 0;
+    me->mcmCount = 0;
+    me->readFifoCount = 0;
+    me->receiving = FALSE;
+    me->safetyTimingRule = 0;
+    CanManager_addReadFifo(me, CAN0_HIPRI, TRUE, 0, 0);
+    CanManager_addReadFifo(me, CAN1_LOPRI, TRUE, 0, 0);
+
     //Activate the CAN channels --------------------------------------------------
     me->ioErr_can0_Init = IO_CAN_Init(IO_CAN_CHANNEL_0, can0_busSpeed, 0, 0, 0);
     me->ioErr_can1_Init = IO_CAN_Init(IO_CAN_CHANNEL_1, can1_busSpeed, 0, 0, 0);
@@ -107,11 +195,12 @@ CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit,
     //, the direction of the queue (in/out)
     //, the frame size
     //, and other stuff?
-    IO_CAN_ConfigFIFO(&me->can0_readHandle, IO_CAN_CHANNEL_0, can0_read_messageLimit, IO_CAN_MSG_READ, IO_CAN_STD_FRAME, 0, 0);
+    //(Read FIFOs come later - their filters depend on the handlers.  See CanManager_startReceiving.)
     IO_CAN_ConfigFIFO(&me->can0_writeHandle, IO_CAN_CHANNEL_0, can0_write_messageLimit, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, 0, 0);
-    IO_CAN_ConfigFIFO(&me->can1_readHandle, IO_CAN_CHANNEL_1, can1_read_messageLimit, IO_CAN_MSG_READ, IO_CAN_STD_FRAME, 0, 0);
     IO_CAN_ConfigFIFO(&me->can1_writeHandle, IO_CAN_CHANNEL_1, can1_write_messageLimit, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, 0, 0);
 
+    //MCM command message objects are configured per controller by CanManager_addMotorController
+
     //Assume read/write at error state until used
     me->ioErr_can0_read = IO_E_CAN_BUS_OFF;
     me->ioErr_can0_write = IO_E_CAN_BUS_OFF;
@@ -121,67 +210,72 @@ CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit,
     //-------------------------------------------------------------------
     //Define default messages
     //-------------------------------------------------------------------
-    //AVLNode* insertedMessage;
-    //insertedMessage = AVL_insert(me->canMessageHistory, 0x0C0, 0, 50000, 125000, TRUE); //MCM command message
-    
-    ubyte2 messageID;
     //Outgoing ----------------------------
-    messageID = 0xC0;  //MCM Command Message
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 25000;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 125000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
-
-    for (messageID = 0x500; messageID <= 0x515; messageID++)
+    //(0xC0 MCM command has its own timing - see canOutput_sendMCUControl)
+    for (ubyte2 messageID = 0x500; messageID <= 0x515; messageID++)
     {
-        me->canMessageHistory[messageID]->timeBetweenMessages_Min = 50000;
-        me->canMessageHistory[messageID]->timeBetweenMessages_Max = 250000;
-        me->canMessageHistory[messageID]->required = TRUE;
-        for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-        IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
+        CanManager_setHistory(me, messageID, 50000, 250000);
     }
 
     //Incoming ----------------------------
-    messageID = 0xAA;  //MCM ______
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 500000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
-
-    messageID = 0xAB;  //MCM ________
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 500000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
-
-    messageID = 0x623;  //BMS faults
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 5000000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
-
-    messageID = 0x629;  //BMS details
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 1000000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
+    //(MCM histories are set up per controller by CanManager_addMotorController)
+    CanManager_setHistory(me, 0x623, 0, 5000000);  //BMS faults
+    CanManager_setHistory(me, 0x629, 0, 1000000);  //BMS details
 
     return me;
 }
 
 
+/*****************************************************************************
+* Message history
+******************************************************************************
+* Returns the history node for a message ID, taking a new node from the pool
+* (with default timing) if this ID has not been seen before.
+****************************************************************************/
+static AVLNode* CanManager_getHistory(CanManager* me, ubyte2 messageID, bool* firstTimeMessage)
+{
+    ubyte1 zeroData[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    AVLNode* history;
+
+    messageID &= 0x7FF;
+    if (me->canMessageHistoryIndex[messageID] != 0)
+    {
+        *firstTimeMessage = FALSE;
+        return &me->canMessageHistory[me->canMessageHistoryIndex[messageID] - 1];
+    }
+
+    if (me->canMessageHistoryCount < CAN_MESSAGE_HISTORY_MAX)
+    {
+        history = &me->canMessageHistory[me->canMessageHistoryCount++];
+        me->canMessageHistoryIndex[messageID] = me->canMessageHistoryCount;
+    }
+    else
+    {
+        history = &me->canMessageHistoryOverflow;
+    }
+
+    AVL_insert(history, zeroData, 25000, 125000, TRUE);
+    history->lastMessage_timeStamp = 0;  //Treat as "sent a long time ago"
+    *firstTimeMessage = TRUE;
+    return history;
+}
+
+static void CanManager_setHistory(CanManager* me, ubyte2 messageID, ubyte4 timeBetweenMessages_Min, ubyte4 timeBetweenMessages_Max)
+{
+    bool firstTimeMessage;
+    AVLNode* history = CanManager_getHistory(me, messageID, &firstTimeMessage);
+    history->timeBetweenMessages_Min = timeBetweenMessages_Min;
+    history->timeBetweenMessages_Max = timeBetweenMessages_Max;
+}
+
 /*****************************************************************************
 * This function takes an array of messages, determines which messages to send
 * based on whether or not data has changed since the last time it was sent,
 * or if a certain amount of time has passed since the last time it was sent.
 *
-* Messages that need to be sent are copied to another array and passed to the
-* FIFO queue.
+* Messages that need to be sent are compacted to the front of the same array
+* (no copy buffer) and passed to the FIFO queue.  The contents of canMessages[]
+* past the returned messages are not preserved.
 *
 * Note: http://stackoverflow.com/questions/5573310/difference-between-passing-array-and-array-pointer-into-function-in-c
 * http://stackoverflow.com/questions/2360794/how-to-pass-an-array-of-struct-using-pointer-in-c-c
@@ -193,12 +287,11 @@ IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRA
     ubyte2 serialMessageID = 0xC0;
     bool sendMessage = FALSE;
     ubyte1 messagesToSendCount = 0;
-    IO_CAN_DATA_FRAME messagesToSend[canMessageCount];//[channel == CAN0_HIPRI ? me->can0_write_messageLimit : me->can1_write_messageLimit];
 
     //----------------------------------------------------------------------------
     // Check if message exists in outgoing message history tree
     //----------------------------------------------------------------------------
-    AVLNode* lastMessage;  //replace with me->canMessageHistory[ID]
+    AVLNode* lastMessage;
     ubyte1 messagePosition; //used twice
     for (messagePosition = 0; messagePosition < canMessageCount; messagePosition++)
     {
@@ -208,22 +301,12 @@ IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRA
         bool maxTimeExceeded = FALSE;
 
         ubyte2 outboundMessageID = canMessages[messagePosition].id;
-        lastMessage = me->canMessageHistory[outboundMessageID];
         sendMessage = FALSE;
 
         //----------------------------------------------------------------------------
-        // Check if this message exists in the array
+        // Check if this message exists in the array (adds it with default timing if not)
         //----------------------------------------------------------------------------
-        firstTimeMessage = (me->canMessageHistory[outboundMessageID] == 0);  //############################## ALWAYS FALSE? ##############################
-        if (firstTimeMessage)
-        {
-            me->canMessageHistory[outboundMessageID]->timeBetweenMessages_Min = 25000;
-            me->canMessageHistory[outboundMessageID]->timeBetweenMessages_Max = 125000;
-            me->canMessageHistory[outboundMessageID]->required = TRUE;
-            for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[outboundMessageID]->data[i] = 0; }
-            //IO_RTC_StartTime(&me->canMessageHistory[outboundMessageID]->lastMessage_timeStamp);
-            me->canMessageHistory[outboundMessageID]->lastMessage_timeStamp = 0;
-        }
+        lastMessage = CanManager_getHistory(me, outboundMessageID, &firstTimeMessage);
 
         //----------------------------------------------------------------------------
         // Check if data has changed since last time message was sent
@@ -267,10 +350,12 @@ IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRA
         //----------------------------------------------------------------------------
         if (sendMessage == TRUE)
         {
-            //copy the message that needs to be sent into the outgoing messages array
-            //see http://stackoverflow.com/questions/1693853/copying-arrays-of-structs-in-c
-            //http://www.socialledge.com/sjsu/index.php?title=ES101_-_Lesson_9_:_Structures
-            messagesToSend[messagesToSendCount++] = canMessages[messagePosition];
+            //Slide the message down over any skipped ones (no copy if nothing was skipped yet)
+            if (messagesToSendCount != messagePosition)
+            {
+                canMessages[messagesToSendCount] = canMessages[messagePosition];
+            }
+            messagesToSendCount++;
         }
         else
         {
@@ -288,29 +373,147 @@ IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRA
     if (messagesToSendCount > 0)
     {
         //Send the messages to send to the appropriate FIFO queue
-        sendResult = IO_CAN_WriteFIFO((channel == CAN0_HIPRI) ? me->can0_writeHandle : me->can1_writeHandle, messagesToSend, messagesToSendCount);
+        sendResult = IO_CAN_WriteFIFO((channel == CAN0_HIPRI) ? me->can0_writeHandle : me->can1_writeHandle, canMessages, messagesToSendCount);
         *((channel == CAN0_HIPRI) ? &me->ioErr_can0_write : &me->ioErr_can1_write) = sendResult;
 
         //Update the outgoing message tree with message sent timestamps
         if ((channel == CAN0_HIPRI ? me->ioErr_can0_write : me->ioErr_can1_write) == IO_E_OK)
         {
-            //Loop through the messages that we sent...
-            ///////////AVLNode* messageToUpdate;
+            //Loop through the messages that we sent and update the message sent timestamp and data
+            bool firstTimeMessage;
             for (messagePosition = 0; messagePosition < messagesToSendCount; messagePosition++)
             {
-                //...find the message ID in the outgoing message tree again (big inefficiency here)...
-                //////////messageToUpdate = AVL_find(me->outgoingTree, messagesToSend[messagePosition].id);
-
-                //and update the message sent timestamp
-                /////////////IO_RTC_GetTimeUS(messageToUpdate->lastMessage_timeStamp); //Update the timestamp for when the message was last sent
-                //IO_RTC_GetTimeUS(me->canMessageHistory[messagesToSend[messagePosition].id]->lastMessage_timeStamp);
-                IO_RTC_StartTime(&me->canMessageHistory[messagesToSend[messagePosition].id]->lastMessage_timeStamp);
+                lastMessage = CanManager_getHistory(me, canMessages[messagePosition].id, &firstTimeMessage);
+                IO_RTC_StartTime(&lastMessage->lastMessage_timeStamp);
+                for (ubyte1 i = 0; i <= 7; i++) { lastMessage->data[i] = canMessages[messagePosition].data[i]; }
+                lastMessage->lastSourceUpdateCount = lastMessage->pendingSourceUpdateCount;
             }
         }
     }
     return sendResult;
 }
 
+/*****************************************************************************
+* Frame builder
+******************************************************************************
+* Frames are built directly in the CanManager's outgoing buffer for a channel:
+*
+*   frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x500);
+*   CanFrame_putUbyte1(frame, throttlePercent);
+*   CanFrame_putUbyte2(frame, Sensor_TPS0.sensorValue);
+*   ...
+*   CanManager_sendFrames(me, CAN0_HIPRI);
+*
+* frame->length is used as the write cursor.  All multi-byte values are
+* written little-endian.  Writes past 8 bytes are dropped.
+****************************************************************************/
+IO_CAN_DATA_FRAME* CanManager_beginFrame(CanManager* me, CanChannel channel, ubyte2 messageID)
+{
+    IO_CAN_DATA_FRAME* frame;
+    ubyte1* outgoingCount = (channel == CAN0_HIPRI) ? &me->can0_outgoingCount : &me->can1_outgoingCount;
+    ubyte1 messageLimit = (channel == CAN0_HIPRI) ? me->can0_write_messageLimit : me->can1_write_messageLimit;
+
+    if (*outgoingCount >= CAN_OUTGOING_FRAMES_MAX || *outgoingCount >= messageLimit)
+    {
+        frame = &me->overflowFrame;
+    }
+    else
+    {
+        frame = (channel == CAN0_HIPRI) ? &me->can0_outgoing[*outgoingCount] : &me->can1_outgoing[*outgoingCount];
+        (*outgoingCount)++;
+    }
+
+    frame->id = messageID;
+    frame->id_format = IO_CAN_STD_FRAME;
+    frame->length = 0;
+    for (ubyte1 i = 0; i <= 7; i++) { frame->data[i] = 0; }  //Unused bytes must be stable for change detection
+
+    return frame;
+}
+
+void CanFrame_putUbyte1(IO_CAN_DATA_FRAME* frame, ubyte1 value)
+{
+    if (frame->length < 8)
+    {
+        frame->data[frame->length++] = value;
+    }
+}
+
+void CanFrame_putUbyte2(IO_CAN_DATA_FRAME* frame, ubyte2 value)
+{
+    CanFrame_putUbyte1(frame, (ubyte1)value);
+    CanFrame_putUbyte1(frame, (ubyte1)(value >> 8));
+}
+
+void CanFrame_putUbyte4(IO_CAN_DATA_FRAME* frame, ubyte4 value)
+{
+    CanFrame_putUbyte2(frame, (ubyte2)value);
+    CanFrame_putUbyte2(frame, (ubyte2)(value >> 16));
+}
+
+//Sends the frames built since the last call, filtered by CanManager_send's change detection
+IO_ErrorType CanManager_sendFrames(CanManager* me, CanChannel channel)
+{
+    IO_ErrorType sendResult;
+    if (channel == CAN0_HIPRI)
+    {
+        sendResult = CanManager_send(me, channel, me->can0_outgoing, me->can0_outgoingCount);
+        me->can0_outgoingCount = 0;
+    }
+    else
+    {
+        sendResult = CanManager_send(me, channel, me->can1_outgoing, me->can1_outgoingCount);
+        me->can1_outgoingCount = 0;
+    }
+    return sendResult;
+}
+
+/*****************************************************************************
+* Dirty tracking
+******************************************************************************
+* Telemetry functions call this before packing a frame, passing the update
+* count of the object(s) the frame is built from.  If nothing changed since
+* the frame was last sent, the frame is skipped entirely (not built, not
+* compared) until timeBetweenMessages_Max passes, at which point it is sent
+* once as a heartbeat.
+*
+* The count is only committed once CanManager_send actually puts the frame
+* on the bus, so a frame held back by timeBetweenMessages_Min is retried.
+****************************************************************************/
+bool CanManager_frameNeeded(CanManager* me, ubyte2 messageID, ubyte2 sourceUpdateCount)
+{
+    bool firstTimeMessage;
+    AVLNode* lastMessage = CanManager_getHistory(me, messageID, &firstTimeMessage);
+    lastMessage->pendingSourceUpdateCount = sourceUpdateCount;
+
+    return (firstTimeMessage)
+        || (sourceUpdateCount != lastMessage->lastSourceUpdateCount)
+        || (IO_RTC_GetTimeUS(lastMessage->lastMessage_timeStamp) >= lastMessage->timeBetweenMessages_Max);
+}
+
+//Sends every frame built since the last call, with no change detection (for streaming data)
+IO_ErrorType CanManager_flushFrames(CanManager* me, CanChannel channel)
+{
+    IO_ErrorType sendResult = IO_E_OK;
+    if (channel == CAN0_HIPRI)
+    {
+        if (me->can0_outgoingCount > 0)
+        {
+            sendResult = me->ioErr_can0_write = IO_CAN_WriteFIFO(me->can0_writeHandle, me->can0_outgoing, me->can0_outgoingCount);
+        }
+        me->can0_outgoingCount = 0;
+    }
+    else
+    {
+        if (me->can1_outgoingCount > 0)
+        {
+            sendResult = me->ioErr_can1_write = IO_CAN_WriteFIFO(me->can1_writeHandle, me->can1_outgoing, me->can1_outgoingCount);
+        }
+        me->can1_outgoingCount = 0;
+    }
+    return sendResult;
+}
+
 /*
 //Helper functions
 ubyte4 CanManager_timeSinceLastTransmit(IO_CAN_DATA_FRAME* canMessage)  //Overflows/resets at 74 min
@@ -319,78 +522,311 @@ bool CanManager_dataChangedSinceLastTransmit(IO_CAN_DATA_FRAME* canMessage) //bi
 */
 
 
+//Dedicated FIFOs must exist before their handlers are added (see CanManager_addHandler)
+static bool CanManager_addReadFifo(CanManager* me, CanChannel channel, bool shared, ubyte2 firstID, ubyte2 lastID)
+{
+    CanReadFifo* fifo;
+
+    if (me->readFifoCount >= CAN_READ_FIFOS_MAX)
+    {
+        SerialManager_send(me->sm, "ERROR: CAN read FIFO table full.\n");
+        return FALSE;
+    }
+
+    fifo = &me->readFifos[me->readFifoCount++];
+    fifo->channel = channel;
+    fifo->shared = shared;
+    fifo->firstID = firstID;
+    fifo->lastID = lastID;
+    fifo->acceptID = 0;
+    fifo->acceptMask = 0;
+    fifo->size = 0;
+    fifo->handle = 0;
+    fifo->ioErr_init = IO_E_CHANNEL_NOT_CONFIGURED;
+    fifo->ioErr_read = IO_E_CAN_BUS_OFF;  //Assume error state until used
+    return TRUE;
+}
+
+//All the bits at and below the highest set bit
+static ubyte2 CanManager_lowBits(ubyte2 value)
+{
+    value |= value >> 1;
+    value |= value >> 2;
+    value |= value >> 4;
+    value |= value >> 8;
+    return value;
+}
+
+/*****************************************************************************
+* Read FIFO setup
+******************************************************************************
+* Each FIFO gets one acceptance filter: the bits every ID its handlers want
+* have in common must match, the rest are don't-care.  That can let in a few
+* extra IDs (e.g. 0x620-0x629 becomes 0x620-0x62F) but never drops a wanted
+* one - CanManager_read still checks exact ranges.  A FIFO with no handlers
+* isn't set up at all.
+*
+* Sizes: dedicated FIFOs split the channel's read limit, after
+* CAN_SHARED_FIFO_SIZE for the shared one (which only carries debug
+* commands and the like).
+****************************************************************************/
+void CanManager_startReceiving(CanManager* me)
+{
+    ubyte1 dedicated[2] = { 0, 0 };
+    ubyte1 limit;
+    ubyte1 sharedSize;
+
+    if (me->receiving == TRUE)
+    {
+        return;
+    }
+    me->receiving = TRUE;
+
+    for (ubyte1 f = 0; f < me->readFifoCount; f++)
+    {
+        if (me->readFifos[f].shared == FALSE) { dedicated[me->readFifos[f].channel]++; }
+    }
+
+    for (ubyte1 f = 0; f < me->readFifoCount; f++)
+    {
+        CanReadFifo* fifo = &me->readFifos[f];
+        ubyte2 reference = 0;
+        ubyte2 varying = 0;
+        bool used = FALSE;
+
+        for (ubyte1 h = 0; h < me->handlerCount; h++)
+        {
+            CanHandlerEntry* entry = &me->handlers[h];
+            if (entry->fifo != f) { continue; }
+            if (used == FALSE)
+            {
+                reference = entry->firstID;
+                used = TRUE;
+            }
+            varying |= CanManager_lowBits(entry->firstID ^ entry->lastID) | (entry->firstID ^ reference);
+        }
+        if (used == FALSE)
+        {
+            continue;
+        }
+
+        limit = (fifo->channel == CAN0_HIPRI) ? me->can0_read_messageLimit : me->can1_read_messageLimit;
+        sharedSize = (dedicated[fifo->channel] == 0) ? limit
+                   : (limit / 2 < CAN_SHARED_FIFO_SIZE) ? limit / 2
+                   : CAN_SHARED_FIFO_SIZE;
+        fifo->size = (fifo->shared == TRUE) ? sharedSize : (limit - sharedSize) / dedicated[fifo->channel];
+        if (fifo->size == 0) { fifo->size = 1; }
+
+        fifo->acceptMask = 0x7FF & ~(ubyte4)varying;
+        fifo->acceptID = reference & fifo->acceptMask;
+        fifo->ioErr_init = IO_CAN_ConfigFIFO(&fifo->handle
+                                            , (fifo->channel == CAN0_HIPRI) ? IO_CAN_CHANNEL_0 : IO_CAN_CHANNEL_1
+                                            , fifo->size, IO_CAN_MSG_READ, IO_CAN_STD_FRAME
+                                            , fifo->acceptID, fifo->acceptMask);
+    }
+}
+
 /*****************************************************************************
-* read
+* Receive routing
+******************************************************************************
+* CanManager_read passes each incoming message to every handler whose channel
+* and ID range match.  Handlers take the object they were registered with, so
+* several objects of the same type (e.g. one MotorController per motor) can
+* share one handler function.
+*
+* Returns FALSE if the table is full (raise CAN_HANDLERS_MAX), or if
+* receiving has already started (the hardware filters are fixed by then).
 ****************************************************************************/
-void CanManager_read(CanManager* me, CanChannel channel, MotorController* mcm, BatteryManagementSystem* bms, SafetyChecker* sc)
+bool CanManager_addHandler(CanManager* me, CanChannel channel, ubyte2 firstID, ubyte2 lastID, CanMessageHandler handler, void* object)
 {
-    IO_CAN_DATA_FRAME canMessages[(channel == CAN0_HIPRI ? me->can0_read_messageLimit : me->can1_read_messageLimit)];
-    ubyte1 canMessageCount;  //FIFO queue only holds 128 messages max
+    CanHandlerEntry* entry;
+
+    if (me->handlerCount >= CAN_HANDLERS_MAX)
+    {
+        SerialManager_send(me->sm, "ERROR: CAN handler table full.\n");
+        return FALSE;
+    }
+    if (me->receiving == TRUE)
+    {
+        SerialManager_send(me->sm, "ERROR: CAN handler added after CanManager_startReceiving.\n");
+        return FALSE;
+    }
 
-    //Read messages from hipri channel 
-    *(channel == CAN0_HIPRI ? &me->ioErr_can0_read : &me->ioErr_can1_read) =
-    IO_CAN_ReadFIFO((channel == CAN0_HIPRI ? me->can0_readHandle : me->can1_writeHandle)
-                    , canMessages
-                    , (channel == CAN0_HIPRI ? me->can0_read_messageLimit : me->can1_read_messageLimit)
-                    , &canMessageCount);
+    entry = &me->handlers[me->handlerCount++];
+    entry->channel = channel;
+    entry->firstID = firstID;
+    entry->lastID = lastID;
+    entry->handler = handler;
+    entry->object = object;
 
-    //Determine message type based on ID
-    for (int currMessage = 0; currMessage < canMessageCount; currMessage++)
+    //Into the channel's dedicated FIFO for this range if there is one, else its shared FIFO
+    entry->fifo = (channel == CAN0_HIPRI) ? 0 : 1;
+    for (ubyte1 f = 0; f < me->readFifoCount; f++)
     {
-        switch (canMessages[currMessage].id)
+        CanReadFifo* fifo = &me->readFifos[f];
+        if (fifo->shared == FALSE && fifo->channel == channel && firstID >= fifo->firstID && lastID <= fifo->lastID)
         {
-        //-------------------------------------------------------------------------
-        //Motor controller
-        //-------------------------------------------------------------------------
-        case 0xA0:
-        case 0xA1:
-        case 0xA2:
-        case 0xA3:
-        case 0xA4:
-        case 0xA5:
-        case 0xA6:
-        case 0xA7:
-        case 0xA8:
-        case 0xA9:
-        case 0xAA:
-        case 0xAB:
-        case 0xAC:
-        case 0xAD:
-        case 0xAE:
-        case 0xAF:
-            MCM_parseCanMessage(mcm, &canMessages[currMessage]);
+            entry->fifo = f;
             break;
+        }
+    }
+    return TRUE;
+}
 
-        //-------------------------------------------------------------------------
-        //BMS
-        //-------------------------------------------------------------------------
-        case 0x620:
-        case 0x621:
-        case 0x622:
-        case 0x623:
-        case 0x624:
-        case 0x625:
-        case 0x626:
-        case 0x627:
-        case 0x628:
-        case 0x629:
-            BMS_parseCanMessage(bms, &canMessages[currMessage]);
-            break;
-            
-        //-------------------------------------------------------------------------
-        //VCU Debug Control
-        //-------------------------------------------------------------------------
-        case 0x5FF:
-            SafetyChecker_parseCanMessage(sc, &canMessages[currMessage]);
-            MCM_parseCanMessage(mcm, &canMessages[currMessage]);
-            break;
-            //default:
+//Adapters from the generic handler signature to each object's parser
+static void CanManager_handleMCM(void* object, IO_CAN_DATA_FRAME* canMessage)
+{
+    MCM_parseCanMessage((MotorController*)object, canMessage);
+}
+
+static void CanManager_handleBMS(void* object, IO_CAN_DATA_FRAME* canMessage)
+{
+    BMS_parseCanMessage((BatteryManagementSystem*)object, canMessage);
+}
+
+static void CanManager_handleSafety(void* object, IO_CAN_DATA_FRAME* canMessage)
+{
+    SafetyChecker_parseCanMessage((SafetyChecker*)object, canMessage);
+}
+
+static void CanManager_handleEnergy(void* object, IO_CAN_DATA_FRAME* canMessage)
+{
+    EnergyEstimator_parseCanMessage((EnergyEstimator*)object, canMessage);
+}
+
+static void CanManager_handleFreezeFrame(void* object, IO_CAN_DATA_FRAME* canMessage)
+{
+    FreezeFrame_parseCanMessage((FreezeFrame*)object, canMessage);
+}
+
+static void CanManager_handleLaunch(void* object, IO_CAN_DATA_FRAME* canMessage)
+{
+    LaunchControl_parseCanMessage((LaunchControl*)object, canMessage);
+}
+
+static void CanManager_handleIsoTp(void* object, IO_CAN_DATA_FRAME* canMessage)
+{
+    IsoTp_parseCanMessage((IsoTp*)object, canMessage);
+}
+
+/*****************************************************************************
+* Registers a motor controller: its 16 broadcast IDs (base + 0x00..0x0F) and
+* 0x5FF (HVIL override) are routed to it, and a dedicated CAN0 message object
+* is set up for its command ID so commands never wait behind debug frames.
+****************************************************************************/
+bool CanManager_addMotorController(CanManager* me, CanChannel channel, MotorController* mcm)
+{
+    ubyte2 baseID = MCM_getCanMessageBaseId(mcm);
+
+    if (me->mcmCount >= MCM_CONTROLLERS_MAX)
+    {
+        return FALSE;
+    }
+
+    me->mcmCommandOwner[me->mcmCount] = mcm;
+    IO_CAN_ConfigMsg(&me->can0_mcmCommandHandle[me->mcmCount], IO_CAN_CHANNEL_0, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, MCM_getCommandMessageId(mcm), 0x7FF);
+    me->ioErr_can0_mcmCommand[me->mcmCount] = IO_E_CAN_BUS_OFF;  //Assume error state until used
+    me->mcmCyclesSinceCommand[me->mcmCount] = MCM_COMMAND_PERIOD_CYCLES;  //Send on the first cycle
+    me->mcmCount++;
+
+    CanManager_setHistory(me, baseID + 0x0A, 0, 500000);  //MCM internal states
+    CanManager_setHistory(me, baseID + 0x0B, 0, 500000);  //MCM faults
+
+    //Own read FIFO for its broadcasts so nothing else on the bus can crowd them out
+    CanManager_addReadFifo(me, channel, FALSE, baseID, baseID + 0x0F);
+
+    return CanManager_addHandler(me, channel, baseID, baseID + 0x0F, CanManager_handleMCM, mcm)
+        && CanManager_addHandler(me, channel, 0x5FF, 0x5FF, CanManager_handleMCM, mcm);
+}
+
+bool CanManager_addBMS(CanManager* me, CanChannel channel, BatteryManagementSystem* bms)
+{
+    //Own read FIFO, so a burst of BMS messages can't fill up the MCM's
+    CanManager_addReadFifo(me, channel, FALSE, 0x620, 0x62F);
+    return CanManager_addHandler(me, channel, 0x620, 0x629, CanManager_handleBMS, bms);
+}
+
+//VCU debug control (0x5FF) - safety check bypass
+bool CanManager_addSafetyChecker(CanManager* me, CanChannel channel, SafetyChecker* sc)
+{
+    return CanManager_addHandler(me, channel, 0x5FF, 0x5FF, CanManager_handleSafety, sc);
+}
+
+//BMS SOC/power (0x626-0x629) and lap marker (0x5FE).  Handlers run in the order
+//they were added, so registering after the BMS means it sees the decoded values.
+bool CanManager_addEnergyEstimator(CanManager* me, CanChannel channel, EnergyEstimator* energy)
+{
+    return CanManager_addHandler(me, channel, 0x626, 0x629, CanManager_handleEnergy, energy)
+        && CanManager_addHandler(me, channel, 0x5FE, 0x5FE, CanManager_handleEnergy, energy);
+}
+
+//Dump/re-arm commands on 0x5FD
+bool CanManager_addFreezeFrame(CanManager* me, CanChannel channel, FreezeFrame* freeze)
+{
+    return CanManager_addHandler(me, channel, 0x5FD, 0x5FD, CanManager_handleFreezeFrame, freeze);
+}
+
+//Arm/cancel commands from the dash on 0x5FC
+bool CanManager_addLaunchControl(CanManager* me, CanChannel channel, LaunchControl* launch)
+{
+    return CanManager_addHandler(me, channel, 0x5FC, 0x5FC, CanManager_handleLaunch, launch);
+}
+
+bool CanManager_addIsoTp(CanManager* me, CanChannel channel, IsoTp* isoTp)
+{
+    return CanManager_addHandler(me, channel, IsoTp_getRxId(isoTp), IsoTp_getRxId(isoTp), CanManager_handleIsoTp, isoTp);
+}
+
+/*****************************************************************************
+* read
+****************************************************************************/
+void CanManager_read(CanManager* me, CanChannel channel)
+{
+    IO_CAN_DATA_FRAME* canMessages = me->readBuffer;
+    ubyte1 canMessageCount = 0;  //FIFO sizes on a channel add up to no more than its read limit, so they all fit
+    ubyte1 fifoMessageCount;
+    IO_ErrorType* ioErr_read = (channel == CAN0_HIPRI) ? &me->ioErr_can0_read : &me->ioErr_can1_read;
+
+    //Read the channel's dedicated FIFOs (in the order they were added - MCM first), then its shared one
+    *ioErr_read = IO_E_OK;
+    for (ubyte1 pass = 0; pass < 2; pass++)
+    {
+        for (ubyte1 f = 0; f < me->readFifoCount; f++)
+        {
+            CanReadFifo* fifo = &me->readFifos[f];
+            if (fifo->channel != channel || fifo->shared != (pass == 1) || fifo->size == 0)
+            {
+                continue;
+            }
+            fifoMessageCount = 0;
+            fifo->ioErr_read = IO_CAN_ReadFIFO(fifo->handle, &canMessages[canMessageCount], fifo->size, &fifoMessageCount);
+            canMessageCount += fifoMessageCount;
+            if (*ioErr_read == IO_E_OK) { *ioErr_read = fifo->ioErr_read; }
         }
     }
 
-    //Echo message on lopri channel
+    //Hand each message to every handler registered for its ID on this channel
+    //(more than one object can listen to the same ID, e.g. 0x5FF).  Filters can
+    //let in extra IDs and overlap, so this goes by ID, not by which FIFO it came from.
+    for (ubyte1 currMessage = 0; currMessage < canMessageCount; currMessage++)
+    {
+        ubyte2 id = canMessages[currMessage].id;
+        for (ubyte1 h = 0; h < me->handlerCount; h++)
+        {
+            CanHandlerEntry* entry = &me->handlers[h];
+            if (entry->channel == channel && id >= entry->firstID && id <= entry->lastID)
+            {
+                entry->handler(entry->object, &canMessages[currMessage]);
+            }
+        }
+    }
+
+    //Echo hipri messages on lopri channel (lopri messages would just come back to it)
     //IO_CAN_WriteFIFO(me->can1_writeHandle, canMessages, messagesReceived);
-    CanManager_send(me, CAN1_LOPRI, canMessages, canMessageCount);
+    if (channel == CAN0_HIPRI)
+    {
+        CanManager_send(me, CAN1_LOPRI, canMessages, canMessageCount);
+    }
     //IO_CAN_WriteMsg(canFifoHandle_LoPri_Write, canMessages);
 }
 
@@ -425,258 +861,605 @@ void canOutput_sendSensorMessages(CanManager* me)
 //----------------------------------------------------------------------------
 void canOutput_sendDebugMessage(CanManager* me, TorqueEncoder* tps, BrakePressureSensor* bps, MotorController* mcm, WheelSpeeds* wss, SafetyChecker* sc)
 {
-    IO_CAN_DATA_FRAME canMessages[me->can0_write_messageLimit];
+    IO_CAN_DATA_FRAME* frame;
     ubyte1 errorCount;
     float4 tempPedalPercent;   //Pedal percent float (a decimal between 0 and 1)
     ubyte1 tps0Percent;        //Pedal percent int   (a number from 0 to 100)
     ubyte1 tps1Percent;
-    ubyte2 canMessageCount = 0;
-    ubyte2 canMessageID = 0x500;
-    ubyte1 byteNum;
-
-    TorqueEncoder_getIndividualSensorPercent(tps, 0, &tempPedalPercent); //borrow the pedal percent variable
-    tps0Percent = 0xFF * tempPedalPercent;
-    TorqueEncoder_getIndividualSensorPercent(tps, 1, &tempPedalPercent);
-    tps1Percent = 0xFF * tempPedalPercent;
-    //tps1Percent = 0xFF * (1 - tempPedalPercent);  //OLD: flipped over pedal percent (this value for display in CAN only)
-
-    TorqueEncoder_getPedalTravel(tps, &errorCount, &tempPedalPercent); //getThrottlePercent(TRUE, &errorCount);
-    ubyte1 throttlePercent = 0xFF * tempPedalPercent;
 
+    //Always calculated - main uses brakePercentage for the brake light
     BrakePressureSensor_getPedalTravel(bps, &errorCount, &tempPedalPercent); //getThrottlePercent(TRUE, &errorCount);
     ubyte1 brakePercent = 0xFF * tempPedalPercent;
     bps->brakePercentage= brakePercent;
 
-    //500: TPS 0
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1; //500
-    canMessages[canMessageCount - 1].data[byteNum++] = throttlePercent;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps0Percent;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_TPS0.sensorValue; // tps->tps0_value;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_TPS0.sensorValue >> 8; //tps->tps0_value >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMin;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMin >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMax;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMax >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
+    //----------------------------------------------------------------------------
+    //Each frame is only packed if its source object(s) changed since it was last
+    //sent, or as a heartbeat (see CanManager_frameNeeded).  Frames built from
+    //several objects use the sum of their update counts.
+    //----------------------------------------------------------------------------
 
+    //500: TPS 0
     //501: TPS 1
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = throttlePercent;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps1Percent;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_value;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_value >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMin;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMin >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMax;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMax >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
+    if (CanManager_frameNeeded(me, 0x500, TorqueEncoder_getUpdateCount(tps))
+        | CanManager_frameNeeded(me, 0x501, TorqueEncoder_getUpdateCount(tps)))
+    {
+        TorqueEncoder_getIndividualSensorPercent(tps, 0, &tempPedalPercent); //borrow the pedal percent variable
+        tps0Percent = 0xFF * tempPedalPercent;
+        TorqueEncoder_getIndividualSensorPercent(tps, 1, &tempPedalPercent);
+        tps1Percent = 0xFF * tempPedalPercent;
+        //tps1Percent = 0xFF * (1 - tempPedalPercent);  //OLD: flipped over pedal percent (this value for display in CAN only)
+
+        TorqueEncoder_getPedalTravel(tps, &errorCount, &tempPedalPercent); //getThrottlePercent(TRUE, &errorCount);
+        ubyte1 throttlePercent = 0xFF * tempPedalPercent;
+
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x500);
+        CanFrame_putUbyte1(frame, throttlePercent);
+        CanFrame_putUbyte1(frame, tps0Percent);
+        CanFrame_putUbyte2(frame, Sensor_TPS0.sensorValue); // tps->tps0_value;
+        CanFrame_putUbyte2(frame, tps->tps0_calibMin);
+        CanFrame_putUbyte2(frame, tps->tps0_calibMax);
+
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x501);
+        CanFrame_putUbyte1(frame, throttlePercent);
+        CanFrame_putUbyte1(frame, tps1Percent);
+        CanFrame_putUbyte2(frame, tps->tps1_value);
+        CanFrame_putUbyte2(frame, tps->tps1_calibMin);
+        CanFrame_putUbyte2(frame, tps->tps1_calibMax);
+    }
 
     //502: BPS
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = brakePercent; //This should be bps0Percent, but for now bps0Percent = brakePercent
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_value;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_value >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMin;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMin >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMax;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMax >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
+    if (CanManager_frameNeeded(me, 0x502, BrakePressureSensor_getUpdateCount(bps)))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x502);
+        CanFrame_putUbyte1(frame, brakePercent); //This should be bps0Percent, but for now bps0Percent = brakePercent
+        CanFrame_putUbyte1(frame, 0);
+        CanFrame_putUbyte2(frame, bps->bps0_value);
+        CanFrame_putUbyte2(frame, bps->bps0_calibMin);
+        CanFrame_putUbyte2(frame, bps->bps0_calibMax);
+    }
 
     //503: WSS 
     //The function WheelSpeed_Update() determines the values of can messages
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, FL) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, FL) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, FR) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, FR) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, RL) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, RL) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, RR) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, RR) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
+    if (CanManager_frameNeeded(me, 0x503, WheelSpeeds_getUpdateCount(wss)))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x503);
+        CanFrame_putUbyte2(frame, (ubyte2)(WheelSpeeds_getWheelSpeed(wss, FL) + 0.5));
+        CanFrame_putUbyte2(frame, (ubyte2)(WheelSpeeds_getWheelSpeed(wss, FR) + 0.5));
+        CanFrame_putUbyte2(frame, (ubyte2)(WheelSpeeds_getWheelSpeed(wss, RL) + 0.5));
+        CanFrame_putUbyte2(frame, (ubyte2)(WheelSpeeds_getWheelSpeed(wss, RR) + 0.5));
+    }
 
     //TEMP, 504: WSS2
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue >> 16;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue >> 24;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue >> 16;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue >> 24;
-    canMessages[canMessageCount - 1].length = byteNum;
+    if (CanManager_frameNeeded(me, 0x504, Sensor_WSS_FL.updateCount + Sensor_WSS_FR.updateCount))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x504);
+        CanFrame_putUbyte4(frame, Sensor_WSS_FL.sensorValue);
+        CanFrame_putUbyte4(frame, Sensor_WSS_FR.sensorValue);
+    }
 
     //TEMP, 505: WSS3 
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;  //505
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue >> 16;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue >> 24;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue >> 16;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue >> 24;
-    canMessages[canMessageCount - 1].length = byteNum;
+    if (CanManager_frameNeeded(me, 0x505, Sensor_WSS_RL.updateCount + Sensor_WSS_RR.updateCount))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x505);
+        CanFrame_putUbyte4(frame, Sensor_WSS_RL.sensorValue);
+        CanFrame_putUbyte4(frame, Sensor_WSS_RR.sensorValue);
+    }
 
     //506: Safety Checker
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc);
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc) >> 16;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc) >> 24;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getWarnings(sc);
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getWarnings(sc) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getNotices(sc);
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getNotices(sc) >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-    //12v battery
-    float4 LVBatterySOC = 0;
-    if (Sensor_LVBattery.sensorValue < 12730)
-        LVBatterySOC = .0 + .1 * getPercent(Sensor_LVBattery.sensorValue, 9200, 12730, FALSE);
-    else if (Sensor_LVBattery.sensorValue < 12866)
-        LVBatterySOC = .1 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12730, 12866, FALSE);
-    else if (Sensor_LVBattery.sensorValue < 12996)
-        LVBatterySOC = .2 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12866, 12996, FALSE);
-    else if (Sensor_LVBattery.sensorValue < 13104)
-        LVBatterySOC = .3 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12996, 13104, FALSE);
-    else if (Sensor_LVBattery.sensorValue < 13116)
-        LVBatterySOC = .4 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13104, 13116, FALSE);
-    else if (Sensor_LVBattery.sensorValue < 13130)
-        LVBatterySOC = .5 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13116, 13130, FALSE);
-    else if (Sensor_LVBattery.sensorValue < 13160)
-        LVBatterySOC = .6 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13130, 13160, FALSE);
-    else if (Sensor_LVBattery.sensorValue < 13270)
-        LVBatterySOC = .7 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13160, 13270, FALSE);
-    else if (Sensor_LVBattery.sensorValue < 13300)
-        LVBatterySOC = .8 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13270, 13300, FALSE);
-    else //if (Sensor_LVBattery.sensorValue < 14340)
-        LVBatterySOC = .9 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13300, 14340, FALSE);
+    if (CanManager_frameNeeded(me, 0x506, SafetyChecker_getUpdateCount(sc)))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x506);
+        CanFrame_putUbyte4(frame, SafetyChecker_getFaults(sc));
+        CanFrame_putUbyte2(frame, SafetyChecker_getWarnings(sc));
+        CanFrame_putUbyte2(frame, SafetyChecker_getNotices(sc));
+    }
 
     //507: LV Battery 
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)Sensor_LVBattery.sensorValue;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_LVBattery.sensorValue >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (sbyte1)(100 * LVBatterySOC);
-    canMessages[canMessageCount - 1].length = byteNum;
+    if (CanManager_frameNeeded(me, 0x507, Sensor_LVBattery.updateCount))
+    {
+        //12v battery
+        float4 LVBatterySOC = 0;
+        if (Sensor_LVBattery.sensorValue < 12730)
+            LVBatterySOC = .0 + .1 * getPercent(Sensor_LVBattery.sensorValue, 9200, 12730, FALSE);
+        else if (Sensor_LVBattery.sensorValue < 12866)
+            LVBatterySOC = .1 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12730, 12866, FALSE);
+        else if (Sensor_LVBattery.sensorValue < 12996)
+            LVBatterySOC = .2 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12866, 12996, FALSE);
+        else if (Sensor_LVBattery.sensorValue < 13104)
+            LVBatterySOC = .3 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12996, 13104, FALSE);
+        else if (Sensor_LVBattery.sensorValue < 13116)
+            LVBatterySOC = .4 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13104, 13116, FALSE);
+        else if (Sensor_LVBattery.sensorValue < 13130)
+            LVBatterySOC = .5 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13116, 13130, FALSE);
+        else if (Sensor_LVBattery.sensorValue < 13160)
+            LVBatterySOC = .6 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13130, 13160, FALSE);
+        else if (Sensor_LVBattery.sensorValue < 13270)
+            LVBatterySOC = .7 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13160, 13270, FALSE);
+        else if (Sensor_LVBattery.sensorValue < 13300)
+            LVBatterySOC = .8 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13270, 13300, FALSE);
+        else //if (Sensor_LVBattery.sensorValue < 14340)
+            LVBatterySOC = .9 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13300, 14340, FALSE);
+
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x507);
+        CanFrame_putUbyte2(frame, Sensor_LVBattery.sensorValue);
+        CanFrame_putUbyte1(frame, (sbyte1)(100 * LVBatterySOC));
+    }
 
     //508: Regen settings
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenMode(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_getRegenTorqueLimitDNm(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenTorqueLimitDNm(mcm) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_getRegenTorqueAtZeroPedalDNm(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenTorqueAtZeroPedalDNm(mcm) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenAPPSForMaxCoastingZeroToFF(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenBPSForMaxRegenZeroToFF(mcm);
-    canMessages[canMessageCount - 1].length = byteNum;
+    //(No update counter for MCM settings/status yet - 508/509 are always packed and left to CanManager_send's change detection)
+    frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x508);
+    CanFrame_putUbyte1(frame, MCM_getRegenMode(mcm));
+    CanFrame_putUbyte2(frame, MCM_getRegenTorqueLimitDNm(mcm));
+    CanFrame_putUbyte2(frame, MCM_getRegenTorqueAtZeroPedalDNm(mcm));
+    CanFrame_putUbyte1(frame, 0);
+    CanFrame_putUbyte1(frame, MCM_getRegenAPPSForMaxCoastingZeroToFF(mcm));
+    CanFrame_putUbyte1(frame, MCM_getRegenBPSForMaxRegenZeroToFF(mcm));
 
     //509: MCM RTD Status
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_HVILTerminationSense.sensorValue;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_HVILTerminationSense.sensorValue >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getHvilOverrideStatus(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
+    Status lockoutStatus = MCM_getLockoutStatus(mcm);
+    frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x509);
+    CanFrame_putUbyte2(frame, Sensor_HVILTerminationSense.sensorValue);
+    CanFrame_putUbyte1(frame, MCM_getHvilOverrideStatus(mcm));
+    CanFrame_putUbyte1(frame, 0);
+    CanFrame_putUbyte1(frame, 0);
+    CanFrame_putUbyte1(frame, 0);
     // Lockout check 
-    if(MCM_getLockoutStatus(mcm) == UNKNOWN) canMessages[canMessageCount - 1].data[byteNum++] = 0x99;
-        else if(MCM_getLockoutStatus(mcm) == DISABLED) canMessages[canMessageCount - 1].data[byteNum++] = 0;
-        else if(MCM_getLockoutStatus(mcm) == ENABLED) canMessages[canMessageCount - 1].data[byteNum++] = 1;
-        else canMessages[canMessageCount - 1].data[byteNum++] = 0xFF;
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getStartupStage(mcm);//showing which state in the RTD state machine
-    canMessages[canMessageCount - 1].length = byteNum;
-
-    // 50A: Reserved for LV testing
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0; // 0
-    canMessages[canMessageCount - 1].data[byteNum++] = 0; // 1
-    canMessages[canMessageCount - 1].data[byteNum++] = 0; // 2
-    canMessages[canMessageCount - 1].data[byteNum++] = 0; // 3
-    canMessages[canMessageCount - 1].data[byteNum++] = 0; // 4
-    canMessages[canMessageCount - 1].data[byteNum++] = 0; // 5
-    canMessages[canMessageCount - 1].data[byteNum++] = 0; // 6
-    canMessages[canMessageCount - 1].data[byteNum++] = 0; // 7
-    canMessages[canMessageCount - 1].length = byteNum;
+    if (lockoutStatus == UNKNOWN) CanFrame_putUbyte1(frame, 0x99);
+        else if (lockoutStatus == DISABLED) CanFrame_putUbyte1(frame, 0);
+        else if (lockoutStatus == ENABLED) CanFrame_putUbyte1(frame, 1);
+        else CanFrame_putUbyte1(frame, 0xFF);
+    CanFrame_putUbyte1(frame, MCM_getStartupStage(mcm));//showing which state in the RTD state machine
+
+    // 50A: Reserved for LV testing (constant - heartbeat only)
+    if (CanManager_frameNeeded(me, 0x50A, 0))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x50A);
+        CanFrame_putUbyte4(frame, 0);
+        CanFrame_putUbyte4(frame, 0);
+    }
 
     //Cooling?
 
     //510 - 51F reserved for dash
 
 
-    //Motor controller command message
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = 0xC0;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_commands_getTorque(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_commands_getTorque(mcm) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;  //Speed (RPM?) - not needed - mcu should be in torque mode
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;  //Speed (RPM?) - not needed - mcu should be in torque mode
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_commands_getDirection(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = (MCM_commands_getInverter(mcm) == ENABLED) ? 1 : 0; //unused/unused/unused/unused unused/unused/Discharge/Inverter Enable
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_commands_getTorqueLimit(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_commands_getTorqueLimit(mcm) >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
+    //Motor controller command message (0xC0) is sent separately by canOutput_sendMCUControl
 
     // 520: Torque Encoder
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id = 0x520;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_TCSKnob.sensorValue;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_TCSKnob.sensorValue >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_EcoButton.sensorValue;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_EcoButton.sensorValue>>8;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_RTDButton.sensorValue;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_RTDButton.sensorValue>>8;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].length = byteNum;
+    if (CanManager_frameNeeded(me, 0x520, Sensor_TCSKnob.updateCount + Sensor_EcoButton.updateCount + Sensor_RTDButton.updateCount))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x520);
+        CanFrame_putUbyte2(frame, Sensor_TCSKnob.sensorValue);
+        CanFrame_putUbyte2(frame, Sensor_EcoButton.sensorValue);
+        CanFrame_putUbyte2(frame, Sensor_RTDButton.sensorValue);
+        CanFrame_putUbyte2(frame, 0);
+    }
 
     //----------------------------------------------------------------------------
     //Additional sensors
     //----------------------------------------------------------------------------
 
     //Place the can messsages into the FIFO queue ---------------------------------------------------
-    //IO_CAN_WriteFIFO(canFifoHandle_HiPri_Write, canMessages, canMessageCount);  //Important: Only transmit one message (the MCU message)
-    CanManager_send(me, CAN0_HIPRI, canMessages, canMessageCount);  //Important: Only transmit one message (the MCU message)
-    //IO_CAN_WriteFIFO(canFifoHandle_LoPri_Write, canMessages, canMessageCount);  
+    CanManager_sendFrames(me, CAN0_HIPRI);
+
+}
+
+
+/*****************************************************************************
+* Motor controller command message (base ID + 0x20, 0xC0 for the MCM at 0xA0)
+******************************************************************************
+* Call right after the commands are final for this cycle, once per controller
+* (each must be registered with CanManager_addMotorController first).  Sent through its
+* own hardware message object, so it goes out immediately regardless of how
+* many debug frames are queued.
+*
+* Sent whenever a command changed, every MCM_COMMAND_PERIOD_CYCLES calls
+* otherwise (keeps the MCM's command timeout from tripping), or always if
+* sendEvenIfNoChanges.  Call exactly once per cycle - the period is counted
+* in calls.
+****************************************************************************/
+bool canOutput_sendMCUControl(CanManager* me, MotorController* mcm, bool sendEvenIfNoChanges)
+{
+    IO_CAN_DATA_FRAME canMessage;
+    ubyte1 slot;
+
+    //Find this controller's command message object
+    for (slot = 0; slot < me->mcmCount && me->mcmCommandOwner[slot] != mcm; slot++);
+    if (slot == me->mcmCount)
+    {
+        return FALSE;  //Not registered with CanManager_addMotorController
+    }
+
+    if (me->mcmCyclesSinceCommand[slot] < 0xFF) { me->mcmCyclesSinceCommand[slot]++; }
+    if (!sendEvenIfNoChanges
+        && MCM_commands_getUpdateCount(mcm) == 0
+        && me->mcmCyclesSinceCommand[slot] < MCM_COMMAND_PERIOD_CYCLES)
+    {
+        return FALSE;
+    }
+
+    canMessage.id = MCM_getCommandMessageId(mcm);
+    canMessage.id_format = IO_CAN_STD_FRAME;
+    canMessage.length = 0;
+    CanFrame_putUbyte2(&canMessage, MCM_commands_getTorque(mcm));
+    CanFrame_putUbyte2(&canMessage, 0);  //Speed (RPM?) - not needed - mcu should be in torque mode
+    CanFrame_putUbyte1(&canMessage, MCM_commands_getDirection(mcm));
+    CanFrame_putUbyte1(&canMessage, (MCM_commands_getInverter(mcm) == ENABLED) ? 1 : 0); //unused/unused/unused/unused unused/unused/Discharge/Inverter Enable
+    CanFrame_putUbyte2(&canMessage, MCM_commands_getTorqueLimit(mcm));
 
+    me->ioErr_can0_mcmCommand[slot] = IO_CAN_WriteMsg(me->can0_mcmCommandHandle[slot], &canMessage);
+
+    //If the message object was still busy, try again next cycle
+    if (me->ioErr_can0_mcmCommand[slot] == IO_E_OK)
+    {
+        MCM_commands_resetUpdateCountAndTime(mcm);
+        me->mcmCyclesSinceCommand[slot] = 0;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*****************************************************************************
+* Chassis sensor messages (shock pots + steering angle)
+******************************************************************************
+* Sent every cycle (~30 Hz, one sample per frame - see chassisSensors.h)
+* 530 (CAN1, DAQ): Bytes 0-7 = shock pots FL/FR/RL/RR raw, 2 bytes each
+* 531 (CAN1, DAQ): Bytes 0-1 = SAS raw, 2 = sample sequence number
+* 535 (CAN0, dash): Decimated.  Bytes 0-3 = shock pots FL/FR/RL/RR in 20mV
+*   steps, bytes 4-5 = SAS raw, byte 6 = sample sequence number.
+*
+* These frames carry a new sample every time, so they are written straight to
+* the FIFO instead of going through CanManager_send's change detection.
+****************************************************************************/
+void canOutput_sendChassisMessages(CanManager* me, ChassisSensors* chassis)
+{
+    IO_CAN_DATA_FRAME* frame;
+
+    frame = CanManager_beginFrame(me, CAN1_LOPRI, 0x530);
+    CanFrame_putUbyte2(frame, ChassisSensors_getLatest(chassis, CHASSIS_WPS_FL));
+    CanFrame_putUbyte2(frame, ChassisSensors_getLatest(chassis, CHASSIS_WPS_FR));
+    CanFrame_putUbyte2(frame, ChassisSensors_getLatest(chassis, CHASSIS_WPS_RL));
+    CanFrame_putUbyte2(frame, ChassisSensors_getLatest(chassis, CHASSIS_WPS_RR));
+
+    frame = CanManager_beginFrame(me, CAN1_LOPRI, 0x531);
+    CanFrame_putUbyte2(frame, ChassisSensors_getLatest(chassis, CHASSIS_SAS));
+    CanFrame_putUbyte1(frame, ChassisSensors_getSequence(chassis));
+    CanManager_flushFrames(me, CAN1_LOPRI);
+
+    if (ChassisSensors_dashboardFrameDue(chassis) == TRUE)
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x535);
+        CanFrame_putUbyte1(frame, ChassisSensors_getLatest(chassis, CHASSIS_WPS_FL) / 20);
+        CanFrame_putUbyte1(frame, ChassisSensors_getLatest(chassis, CHASSIS_WPS_FR) / 20);
+        CanFrame_putUbyte1(frame, ChassisSensors_getLatest(chassis, CHASSIS_WPS_RL) / 20);
+        CanFrame_putUbyte1(frame, ChassisSensors_getLatest(chassis, CHASSIS_WPS_RR) / 20);
+        CanFrame_putUbyte2(frame, ChassisSensors_getLatest(chassis, CHASSIS_SAS));
+        CanFrame_putUbyte1(frame, ChassisSensors_getSequence(chassis));
+        CanManager_flushFrames(me, CAN0_HIPRI);
+    }
+}
+
+/*****************************************************************************
+* 50B: Stack monitor
+******************************************************************************
+* Bytes 0-1 = deepest stack use seen (bytes below main), 2-3 = bytes painted,
+* 4 = % of painted area used, 5 = 1 if the painted area was exhausted
+****************************************************************************/
+void canOutput_sendStackMessage(CanManager* me, StackMonitor* stack)
+{
+    IO_CAN_DATA_FRAME* frame;
+    ubyte2 highWater = StackMonitor_getHighWaterBytes(stack);
+    ubyte2 painted = StackMonitor_getPaintedBytes(stack);
+
+    //High water mark only ever grows, so it doubles as the update count
+    if (CanManager_frameNeeded(me, 0x50B, highWater))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x50B);
+        CanFrame_putUbyte2(frame, highWater);
+        CanFrame_putUbyte2(frame, painted);
+        CanFrame_putUbyte1(frame, (painted == 0) ? 0 : (ubyte1)((ubyte4)highWater * 100 / painted));
+        CanFrame_putUbyte1(frame, StackMonitor_getOverflow(stack));
+        CanManager_sendFrames(me, CAN0_HIPRI);
+    }
+}
+
+/*****************************************************************************
+* Pedal-to-torque latency (see latencyTracer.h)
+******************************************************************************
+* 50C: Stage times this cycle, us after the pedal sample (ubyte2 each):
+*      TPS update, commands calculated, safety reduction, 0xC0 sent
+*      (0 = no 0xC0 this cycle)
+* 50D: Echo latency histogram (0xC0 change -> 0xAC echo), one byte per
+*      10 ms bucket (0-10, 10-20, ... 60-70, 70+/timeout), saturating counts
+****************************************************************************/
+void canOutput_sendLatencyMessages(CanManager* me, LatencyTracer* tracer)
+{
+    IO_CAN_DATA_FRAME* frame;
+
+    frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x50C);
+    for (ubyte1 stage = 0; stage < LATENCY_STAGE_COUNT; stage++)
+    {
+        CanFrame_putUbyte2(frame, LatencyTracer_getStageTime(tracer, stage));
+    }
+
+    if (CanManager_frameNeeded(me, 0x50D, LatencyTracer_getUpdateCount(tracer)))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x50D);
+        for (ubyte1 bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++)
+        {
+            CanFrame_putUbyte1(frame, LatencyTracer_getBucketCount(tracer, bucket));
+        }
+    }
+
+    CanManager_sendFrames(me, CAN0_HIPRI);
+}
+
+/*****************************************************************************
+* 50E: MCM startup timing (see MCM_inverterControl)
+******************************************************************************
+* ms after HVIL went high (ubyte2 each, 0xFFFF = not reached yet):
+* Bytes 0-1 = lockout disabled, 2-3 = RTD accepted (inverter enable sent),
+* 4-5 = inverter enabled.  Byte 6 = current stage, 7 = transition counter
+****************************************************************************/
+void canOutput_sendStartupMessage(CanManager* me, MotorController* mcm)
+{
+    IO_CAN_DATA_FRAME* frame;
+
+    if (CanManager_frameNeeded(me, 0x50E, MCM_getStartupTransitionCount(mcm)))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x50E);
+        CanFrame_putUbyte2(frame, MCM_getStageEnteredMs(mcm, MCM_STAGE_WAIT_RTD));
+        CanFrame_putUbyte2(frame, MCM_getStageEnteredMs(mcm, MCM_STAGE_WAIT_INVERTER));
+        CanFrame_putUbyte2(frame, MCM_getStageEnteredMs(mcm, MCM_STAGE_RTD_COMPLETE));
+        CanFrame_putUbyte1(frame, MCM_getStartupStage(mcm));
+        CanFrame_putUbyte1(frame, MCM_getStartupTransitionCount(mcm));
+        CanManager_sendFrames(me, CAN0_HIPRI);
+    }
+}
+
+/*****************************************************************************
+* 521: Thermal derating (see thermalDerating.h)
+******************************************************************************
+* Bytes 0-3 = torque % allowed: overall, motor, inverter, battery
+* 4 = motor temp, 5 = hottest inverter module, 6 = hottest cell (C, signed)
+* 7 = limiting source (0 none, 1 motor, 2 inverter, 3 battery)
+****************************************************************************/
+void canOutput_sendThermalMessage(CanManager* me, ThermalDerating* thermal, MotorController* mcm, BatteryManagementSystem* bms)
+{
+    IO_CAN_DATA_FRAME* frame;
+
+    if (CanManager_frameNeeded(me, 0x521, ThermalDerating_getUpdateCount(thermal)))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x521);
+        CanFrame_putUbyte1(frame, ThermalDerating_getPercent(thermal, THERMAL_SOURCE_NONE));
+        CanFrame_putUbyte1(frame, ThermalDerating_getPercent(thermal, THERMAL_SOURCE_MOTOR));
+        CanFrame_putUbyte1(frame, ThermalDerating_getPercent(thermal, THERMAL_SOURCE_INVERTER));
+        CanFrame_putUbyte1(frame, ThermalDerating_getPercent(thermal, THERMAL_SOURCE_BATTERY));
+        CanFrame_putUbyte1(frame, (ubyte1)MCM_getMotorTemp(mcm));
+        CanFrame_putUbyte1(frame, (ubyte1)MCM_getTemp(mcm));
+        CanFrame_putUbyte1(frame, (ubyte1)BMS_getMaxTemp(bms));
+        CanFrame_putUbyte1(frame, ThermalDerating_getLimitingSource(thermal));
+        CanManager_sendFrames(me, CAN0_HIPRI);
+    }
+}
+
+/*****************************************************************************
+* 522: Power limiter (see powerLimiter.h)
+******************************************************************************
+* sbyte2, 0.1 kW: 0-1 = 100 ms average, 2-3 = 500 ms average, 4-5 = latest
+* 6 = torque % allowed by the limiter, 7 = 1 if limiting
+* New averages every cycle, so no change detection.
+****************************************************************************/
+void canOutput_sendPowerMessage(CanManager* me, PowerLimiter* power)
+{
+    IO_CAN_DATA_FRAME* frame;
+
+    frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x522);
+    CanFrame_putUbyte2(frame, (ubyte2)(sbyte2)(PowerLimiter_getAverageW(power, POWER_WINDOW_SHORT) / 100));
+    CanFrame_putUbyte2(frame, (ubyte2)(sbyte2)(PowerLimiter_getAverageW(power, POWER_WINDOW_LONG) / 100));
+    CanFrame_putUbyte2(frame, (ubyte2)(sbyte2)(PowerLimiter_getInstantW(power) / 100));
+    CanFrame_putUbyte1(frame, (ubyte1)(PowerLimiter_getMultiplier(power) * 100));
+    CanFrame_putUbyte1(frame, PowerLimiter_isLimiting(power));
+    CanManager_flushFrames(me, CAN0_HIPRI);
+}
+
+/*****************************************************************************
+* 523: Energy estimator (see energyEstimator.h)
+******************************************************************************
+* 0-1 = remaining energy (Wh), 2-3 = last lap energy (Wh),
+* 4-5 = last lap average power (0.1 kW), 6 = lap count, 7 = estimated SOC %
+****************************************************************************/
+void canOutput_sendEnergyMessage(CanManager* me, EnergyEstimator* energy)
+{
+    IO_CAN_DATA_FRAME* frame;
+
+    if (CanManager_frameNeeded(me, 0x523, EnergyEstimator_getUpdateCount(energy)))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x523);
+        CanFrame_putUbyte2(frame, EnergyEstimator_getRemainingWh(energy));
+        CanFrame_putUbyte2(frame, EnergyEstimator_getLastLapWh(energy));
+        CanFrame_putUbyte2(frame, EnergyEstimator_getLastLapAveragePowerW100(energy));
+        CanFrame_putUbyte1(frame, EnergyEstimator_getLapCount(energy));
+        CanFrame_putUbyte1(frame, EnergyEstimator_getSOCPercent(energy));
+        CanManager_sendFrames(me, CAN0_HIPRI);
+    }
+}
+
+/*****************************************************************************
+* 525: Eco mode (see ecoMode.h)
+******************************************************************************
+* 0 = 1 if eco mode on, 1 = laps remaining,
+* 2-3 = eco power cap (0.1 kW, FFFF = none), 4-5 = average power budget (0.1 kW)
+* 6-7 = power limiter target actually in use (0.1 kW)
+****************************************************************************/
+void canOutput_sendEcoMessage(CanManager* me, EcoMode* eco, PowerLimiter* power)
+{
+    IO_CAN_DATA_FRAME* frame;
+    sbyte4 capW = EcoMode_getPowerCapW(eco);
+
+    if (CanManager_frameNeeded(me, 0x525, EcoMode_getUpdateCount(eco)))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x525);
+        CanFrame_putUbyte1(frame, EcoMode_isOn(eco));
+        CanFrame_putUbyte1(frame, EcoMode_getLapsRemaining(eco));
+        CanFrame_putUbyte2(frame, (capW >= 0xFFFF * 100) ? 0xFFFF : (ubyte2)(capW / 100));
+        CanFrame_putUbyte2(frame, (ubyte2)(EcoMode_getAveragePowerBudgetW(eco) / 100));
+        CanFrame_putUbyte2(frame, (ubyte2)(PowerLimiter_getTargetW(power) / 100));
+        CanManager_sendFrames(me, CAN0_HIPRI);
+    }
+}
+
+/*****************************************************************************
+* 524: Launch control (see launchControl.h)
+******************************************************************************
+* 0 = LaunchState (the dash's launch indicator), 1-2 = rear slip (sbyte2, 0.1 %), 3-4 = launch torque cap (DNm)
+* 5-6 = torque command after the cap (DNm), 7 = ground speed (km/h)
+* Every cycle during a launch, otherwise on state changes/heartbeat.
+****************************************************************************/
+void canOutput_sendLaunchMessage(CanManager* me, LaunchControl* launch, MotorController* mcm)
+{
+    IO_CAN_DATA_FRAME* frame;
+
+    bool launching = (LaunchControl_getState(launch) == LAUNCH_ACTIVE);
+
+    if (launching || CanManager_frameNeeded(me, 0x524, LaunchControl_getUpdateCount(launch)))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x524);
+        CanFrame_putUbyte1(frame, LaunchControl_getState(launch));
+        CanFrame_putUbyte2(frame, (ubyte2)LaunchControl_getSlipPercentX10(launch));
+        CanFrame_putUbyte2(frame, (ubyte2)LaunchControl_getTorqueLimitDNm(launch));
+        CanFrame_putUbyte2(frame, (ubyte2)MCM_commands_getTorque(mcm));
+        CanFrame_putUbyte1(frame, LaunchControl_getGroundSpeedKPH(launch));
+        if (launching)
+        {
+            CanManager_flushFrames(me, CAN0_HIPRI);
+        }
+        else
+        {
+            CanManager_sendFrames(me, CAN0_HIPRI);
+        }
+    }
+}
+
+/*****************************************************************************
+* 50F: Safety rule timing (see safety.c)
+******************************************************************************
+* One rule per cycle, round robin (always sent - the next rule is new data
+* even when nothing changed):
+* 0 = rule index, 1 = rule count, 2 = rule's SafetyFlag,
+* 3-4 = rule's slowest evaluation (us), 5-6 = slowest pass over all rules (us)
+****************************************************************************/
+void canOutput_sendSafetyRuleTiming(CanManager* me, SafetyChecker* sc)
+{
+    IO_CAN_DATA_FRAME* frame;
+    ubyte1 rule;
+
+    if (me->safetyTimingRule >= SafetyChecker_getRuleCount(sc)) { me->safetyTimingRule = 0; }
+    rule = me->safetyTimingRule;
+
+    frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x50F);
+    CanFrame_putUbyte1(frame, rule);
+    CanFrame_putUbyte1(frame, SafetyChecker_getRuleCount(sc));
+    CanFrame_putUbyte1(frame, SafetyChecker_getRuleFlag(sc, rule));
+    CanFrame_putUbyte2(frame, SafetyChecker_getRuleMaxUs(sc, rule));
+    CanFrame_putUbyte2(frame, SafetyChecker_getEvaluationMaxUs(sc));
+
+    //Only move on once this rule actually went out
+    if (CanManager_flushFrames(me, CAN0_HIPRI) == IO_E_OK)
+    {
+        me->safetyTimingRule++;
+    }
+}
+
+/*****************************************************************************
+* Freeze frame (see freezeFrame.h)
+******************************************************************************
+* 526: 0 = FreezeState, 1 = samples held, 2 = faulting sample,
+*      3 = samples before the fault (FREEZE_PRE_CYCLES),
+*      4-7 = faults that were new in the faulting cycle
+* 527/528: one snapshot per cycle while a dump is running (0x5FD 0xF0, frozen only).
+*      Byte 0 = sample index, 1-7 = snapshot bytes 0-6 (527) / 7-13 (528)
+****************************************************************************/
+void canOutput_sendFreezeFrame(CanManager* me, FreezeFrame* freeze)
+{
+    IO_CAN_DATA_FRAME* frame;
+    const ubyte1* snapshot;
+    ubyte1 sample;
+
+    if (CanManager_frameNeeded(me, 0x526, FreezeFrame_getUpdateCount(freeze)))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x526);
+        CanFrame_putUbyte1(frame, FreezeFrame_getState(freeze));
+        CanFrame_putUbyte1(frame, FreezeFrame_getSampleCount(freeze));
+        CanFrame_putUbyte1(frame, FreezeFrame_getTriggerSample(freeze));
+        CanFrame_putUbyte1(frame, FREEZE_PRE_CYCLES);
+        CanFrame_putUbyte4(frame, FreezeFrame_getTriggerFaults(freeze));
+        CanManager_sendFrames(me, CAN0_HIPRI);
+    }
+
+    if (FreezeFrame_nextDumpSample(freeze, &sample) == TRUE)
+    {
+        snapshot = FreezeFrame_getSample(freeze, sample);
+        for (ubyte1 half = 0; half < 2; half++)
+        {
+            frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x527 + half);
+            CanFrame_putUbyte1(frame, sample);
+            for (ubyte1 i = 0; i < 7; i++)
+            {
+                CanFrame_putUbyte1(frame, snapshot[half * 7 + i]);
+            }
+        }
+        CanManager_flushFrames(me, CAN0_HIPRI);
+    }
+}
+
+/*****************************************************************************
+* 529: Fault log (see faultLog.h)
+******************************************************************************
+* 0-3 = operating seconds (all time), 4-5 = events logged since power-up,
+* 6 = last event's FaultLogSource, 7 = last event's code
+****************************************************************************/
+void canOutput_sendFaultLogMessage(CanManager* me, FaultLog* log)
+{
+    IO_CAN_DATA_FRAME* frame;
+
+    if (CanManager_frameNeeded(me, 0x529, FaultLog_getUpdateCount(log)))
+    {
+        frame = CanManager_beginFrame(me, CAN0_HIPRI, 0x529);
+        CanFrame_putUbyte4(frame, FaultLog_getOperatingSeconds(log));
+        CanFrame_putUbyte2(frame, FaultLog_getSessionEvents(log));
+        CanFrame_putUbyte1(frame, FaultLog_getLastSource(log));
+        CanFrame_putUbyte1(frame, FaultLog_getLastCode(log));
+        CanManager_sendFrames(me, CAN0_HIPRI);
+    }
+}
+
+/*****************************************************************************
+* ISO-TP response frames (see isoTp.h)
+******************************************************************************
+* Up to ISOTP_FRAMES_PER_CYCLE frames a cycle, so a long response goes out
+* over several cycles and leaves room in the write FIFO for everything else.
+* Every frame is part of a transfer, so no change detection.
+****************************************************************************/
+void canOutput_sendIsoTpFrames(CanManager* me, CanChannel channel, IsoTp* isoTp)
+{
+    IO_CAN_DATA_FRAME* frame;
+    ubyte1 data[8];
+    ubyte1 length;
+    ubyte1 count = 0;
+
+    while (count < ISOTP_FRAMES_PER_CYCLE && IsoTp_nextFrame(isoTp, data, &length) == TRUE)
+    {
+        frame = CanManager_beginFrame(me, channel, IsoTp_getTxId(isoTp));
+        for (ubyte1 i = 0; i < length; i++)
+        {
+            CanFrame_putUbyte1(frame, data[i]);
+        }
+        count++;
+    }
+
+    if (count > 0)
+    {
+        CanManager_flushFrames(me, channel);
+    }
 }
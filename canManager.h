@@ -9,6 +9,17 @@
 #include "bms.h"
 #include "wheelSpeeds.h"
 #include "safety.h"
+#include "chassisSensors.h"
+#include "stackMonitor.h"
+#include "latencyTracer.h"
+#include "thermalDerating.h"
+#include "powerLimiter.h"
+#include "energyEstimator.h"
+#include "ecoMode.h"
+#include "launchControl.h"
+#include "freezeFrame.h"
+#include "faultLog.h"
+#include "isoTp.h"
 
 typedef enum { CAN0_HIPRI, CAN1_LOPRI } CanChannel;
 //CAN0: 48 messages per handle (48 read, 48 write)
@@ -16,6 +27,26 @@ typedef enum { CAN0_HIPRI, CAN1_LOPRI } CanChannel;
 
 typedef struct _CanManager CanManager;
 
+//Size of each channel's outgoing frame buffer (CAN0 hardware max per handle)
+#define CAN_OUTGOING_FRAMES_MAX 48
+//Size of the buffer CanManager_read pulls a channel's read FIFO into (read limits are capped to this)
+#define CAN_READ_FRAMES_MAX 48
+
+//0xC0 is re-sent every this many main loop cycles even if no command changed.
+//Counted in cycles, not us, so the cadence is exact: 1 = every 33 ms cycle (~30 Hz).
+#define MCM_COMMAND_PERIOD_CYCLES 1
+
+//Number of message IDs (sent or echoed) that get their own change-detection history
+#define CAN_MESSAGE_HISTORY_MAX 96
+
+//Number of receive routes (CanManager_addHandler).  Each motor controller uses 2.
+#define CAN_HANDLERS_MAX 16
+
+//Read FIFOs: one shared per channel, plus one per motor controller and one for the BMS
+#define CAN_READ_FIFOS_MAX 8
+//Read limit given to a channel's shared FIFO when it also has dedicated ones (the rest are split evenly)
+#define CAN_SHARED_FIFO_SIZE 8
+
 typedef struct _CanMessageNode CanMessageNode;
 
 //Note: Sum of messageLimits must be < 128 (hardware only does 128 total messages)
@@ -24,12 +55,51 @@ CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit,
                          , ubyte4 defaultSendDelayus, SerialManager* sm);
 IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRAME canMessages[], ubyte1 canMessageCount);
 
+//Frame builder: build frames in place in the channel's outgoing buffer, then send them all at once
+IO_CAN_DATA_FRAME* CanManager_beginFrame(CanManager* me, CanChannel channel, ubyte2 messageID);
+void CanFrame_putUbyte1(IO_CAN_DATA_FRAME* frame, ubyte1 value);
+void CanFrame_putUbyte2(IO_CAN_DATA_FRAME* frame, ubyte2 value);  //Little-endian
+void CanFrame_putUbyte4(IO_CAN_DATA_FRAME* frame, ubyte4 value);  //Little-endian
+IO_ErrorType CanManager_sendFrames(CanManager* me, CanChannel channel);   //With change detection (see CanManager_send)
+IO_ErrorType CanManager_flushFrames(CanManager* me, CanChannel channel);  //Everything, no change detection
+
+//Dirty tracking: TRUE if the source's update count moved since the message was last sent, or its max period (heartbeat) is up
+bool CanManager_frameNeeded(CanManager* me, ubyte2 messageID, ubyte2 sourceUpdateCount);
+
+//Receive routing: CanManager_read hands every message in [firstID, lastID] on the channel to handler(object, message).
+//Register every handler before CanManager_startReceiving - the hardware acceptance filters are built from them.
+typedef void (*CanMessageHandler)(void* object, IO_CAN_DATA_FRAME* canMessage);
+bool CanManager_addHandler(CanManager* me, CanChannel channel, ubyte2 firstID, ubyte2 lastID, CanMessageHandler handler, void* object);
+bool CanManager_addMotorController(CanManager* me, CanChannel channel, MotorController* mcm);  //Also sets up its command message object
+bool CanManager_addBMS(CanManager* me, CanChannel channel, BatteryManagementSystem* bms);
+bool CanManager_addSafetyChecker(CanManager* me, CanChannel channel, SafetyChecker* sc);
+bool CanManager_addEnergyEstimator(CanManager* me, CanChannel channel, EnergyEstimator* energy);  //Register after the BMS
+bool CanManager_addFreezeFrame(CanManager* me, CanChannel channel, FreezeFrame* freeze);
+bool CanManager_addLaunchControl(CanManager* me, CanChannel channel, LaunchControl* launch);
+bool CanManager_addIsoTp(CanManager* me, CanChannel channel, IsoTp* isoTp);  //Its request ID
+
+//Sets up the read FIFOs, each accepting only the IDs its handlers want.  Call once, after the last CanManager_add*.
+void CanManager_startReceiving(CanManager* me);
+
 //Reads and distributes can messages to their appropriate subsystem objects so they can updates themselves
-void CanManager_read(CanManager* me, CanChannel channel, MotorController* mcm, BatteryManagementSystem* bms, SafetyChecker* sc);
+void CanManager_read(CanManager* me, CanChannel channel);
 
 void canOutput_sendSensorMessages(CanManager* me);
-//void canOutput_sendMCUControl(CanManager* me, MotorController* mcm, bool sendEvenIfNoChanges);
+bool canOutput_sendMCUControl(CanManager* me, MotorController* mcm, bool sendEvenIfNoChanges);  //TRUE if 0xC0 went out
 void canOutput_sendDebugMessage(CanManager* me, TorqueEncoder* tps, BrakePressureSensor* bps, MotorController* mcm, WheelSpeeds* wss, SafetyChecker* sc);
+void canOutput_sendChassisMessages(CanManager* me, ChassisSensors* chassis);
+void canOutput_sendStackMessage(CanManager* me, StackMonitor* stack);
+void canOutput_sendLatencyMessages(CanManager* me, LatencyTracer* tracer);
+void canOutput_sendStartupMessage(CanManager* me, MotorController* mcm);
+void canOutput_sendThermalMessage(CanManager* me, ThermalDerating* thermal, MotorController* mcm, BatteryManagementSystem* bms);
+void canOutput_sendPowerMessage(CanManager* me, PowerLimiter* power);
+void canOutput_sendEnergyMessage(CanManager* me, EnergyEstimator* energy);
+void canOutput_sendEcoMessage(CanManager* me, EcoMode* eco, PowerLimiter* power);
+void canOutput_sendLaunchMessage(CanManager* me, LaunchControl* launch, MotorController* mcm);
+void canOutput_sendSafetyRuleTiming(CanManager* me, SafetyChecker* sc);
+void canOutput_sendFreezeFrame(CanManager* me, FreezeFrame* freeze);
+void canOutput_sendFaultLogMessage(CanManager* me, FaultLog* log);
+void canOutput_sendIsoTpFrames(CanManager* me, CanChannel channel, IsoTp* isoTp);
 
 ubyte1 CanManager_getReadStatus(CanManager* me, CanChannel channel);
 
@@ -0,0 +1,79 @@
+#include "IO_Driver.h"
+
+#include "chassisSensors.h"
+#include "sensors.h"
+
+/*****************************************************************************
+* Chassis Sensors object
+******************************************************************************
+* Sensor_WPS_x / Sensor_SAS are read by sensors_updateSensors() once per
+* main loop cycle (SENSOR_PERIOD_FAST).  This object just latches them
+* together each cycle and numbers the set, so the DAQ can spot dropped frames.
+****************************************************************************/
+struct _ChassisSensors
+{
+    Sensor* sensors[CHASSIS_CHANNEL_COUNT];
+
+    ubyte2 latest[CHASSIS_CHANNEL_COUNT];
+    ubyte1 sequence;  //Incremented every sample, so the DAQ can spot dropped frames
+
+    ubyte1 dashboardDecimation;  //Send 1 dashboard frame every x samples
+    ubyte1 dashboardCounter;
+};
+
+static struct _ChassisSensors chassisSensorsInstance;
+
+ChassisSensors* ChassisSensors_new(ubyte1 dashboardDecimation)
+{
+    ChassisSensors* me = &chassisSensorsInstance;
+
+    me->sensors[CHASSIS_WPS_FL] = NULL;  //No pin assigned yet (see vcu_initializeADC)
+    me->sensors[CHASSIS_WPS_FR] = &Sensor_WPS_FR;
+    me->sensors[CHASSIS_WPS_RL] = &Sensor_WPS_RL;
+    me->sensors[CHASSIS_WPS_RR] = &Sensor_WPS_RR;
+    me->sensors[CHASSIS_SAS] = NULL;     //No pin assigned yet
+
+    for (ubyte1 channel = 0; channel < CHASSIS_CHANNEL_COUNT; channel++)
+    {
+        me->latest[channel] = 0;
+    }
+    me->sequence = 0;
+
+    me->dashboardDecimation = (dashboardDecimation == 0) ? 1 : dashboardDecimation;
+    me->dashboardCounter = 0;
+
+    return me;
+}
+
+//Call once per cycle, after sensors_updateSensors()
+void ChassisSensors_update(ChassisSensors* me)
+{
+    for (ubyte1 channel = 0; channel < CHASSIS_CHANNEL_COUNT; channel++)
+    {
+        me->latest[channel] = (me->sensors[channel] == NULL) ? 0 : (ubyte2)me->sensors[channel]->sensorValue;
+    }
+    me->sequence++;
+
+    me->dashboardCounter++;
+}
+
+ubyte2 ChassisSensors_getLatest(ChassisSensors* me, ChassisChannel channel)
+{
+    return me->latest[channel];
+}
+
+ubyte1 ChassisSensors_getSequence(ChassisSensors* me)
+{
+    return me->sequence;
+}
+
+//Returns TRUE once every dashboardDecimation cycles
+bool ChassisSensors_dashboardFrameDue(ChassisSensors* me)
+{
+    if (me->dashboardCounter >= me->dashboardDecimation)
+    {
+        me->dashboardCounter = 0;
+        return TRUE;
+    }
+    return FALSE;
+}
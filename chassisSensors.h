@@ -0,0 +1,44 @@
+#ifndef _CHASSISSENSORS_H
+#define _CHASSISSENSORS_H
+
+#include "IO_Driver.h"
+#include "sensors.h"
+
+/*****************************************************************************
+* Chassis Sensors (shock pots + steering angle)
+******************************************************************************
+* Collects the wheel position sensors (shock pots) and steering angle sensor
+* every main loop cycle.  Channels without a pin assigned (FL shock pot and
+* SAS for now) always read 0.  Every cycle's values go to the DAQ (CAN1), and
+* a decimated copy is made available for the live dashboard (CAN0).
+*
+* Frames themselves are built by canOutput_sendChassisMessages (canManager.c)
+*
+* Limitation: the sample rate is the main loop rate (one sample per 33 ms
+* cycle, ~30 Hz), so each DAQ frame carries exactly one sample.  Going faster
+* needs the ADC read from a timer (or an ADC-driven buffer) instead of
+* sensors_updateSensors.
+****************************************************************************/
+
+typedef enum
+{
+      CHASSIS_WPS_FL
+    , CHASSIS_WPS_FR
+    , CHASSIS_WPS_RL
+    , CHASSIS_WPS_RR
+    , CHASSIS_SAS
+    , CHASSIS_CHANNEL_COUNT
+} ChassisChannel;
+
+typedef struct _ChassisSensors ChassisSensors;
+
+ChassisSensors* ChassisSensors_new(ubyte1 dashboardDecimation);
+void ChassisSensors_update(ChassisSensors* me);
+
+ubyte2 ChassisSensors_getLatest(ChassisSensors* me, ChassisChannel channel);
+ubyte1 ChassisSensors_getSequence(ChassisSensors* me);
+
+//Dashboard (decimated) frame
+bool ChassisSensors_dashboardFrameDue(ChassisSensors* me);
+
+#endif //  _CHASSISSENSORS_H
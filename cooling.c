@@ -1,4 +1,3 @@
-#include <stdlib.h>
 #include "IO_Driver.h"
 //#include "IO_DIO.h"
 //#include "IO_PWM.h"
@@ -11,9 +10,11 @@
 #include "bms.h"
 
 //All temperatures in C
+static struct _CoolingSystem coolingSystemInstance;
+
 CoolingSystem* CoolingSystem_new(SerialManager* serialMan)
 {
-    CoolingSystem* me = (CoolingSystem*)malloc(sizeof(struct _CoolingSystem));
+    CoolingSystem* me = &coolingSystemInstance;
     SerialManager* sm = serialMan;
 
     //Cooling systems:
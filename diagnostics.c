@@ -0,0 +1,288 @@
+#include "IO_Driver.h"
+
+#include "diagnostics.h"
+#include "isoTp.h"
+#include "freezeFrame.h"
+#include "faultLog.h"
+#include "safety.h"
+#include "stackMonitor.h"
+#include "torqueMap.h"
+#include "motorController.h"
+
+#define DIAG_FREEZE_FRAME 0x01
+#define DIAG_FAULT_COUNTS 0x02
+#define DIAG_FAULT_RECORDS 0x03
+#define DIAG_PROFILING 0x04
+#define DIAG_TORQUEMAP_READ 0x05
+#define DIAG_TORQUEMAP_WRITE 0x06
+
+#define DIAG_POSITIVE 0x40
+#define DIAG_NEGATIVE 0x7F
+#define DIAG_NRC_SERVICE 0x11
+#define DIAG_NRC_LENGTH 0x13
+#define DIAG_NRC_CONDITIONS 0x22
+#define DIAG_NRC_RANGE 0x31
+
+#define DIAG_HEADER_MAX 12
+#define DIAG_FAULT_CODES 128  //Same order as FaultLog's counts (VCU 32, MCM 64, BMS 32)
+#define DIAG_TORQUEMAP_CELLS (TORQUEMAP_SPEED_POINTS * TORQUEMAP_PEDAL_POINTS)
+
+struct _Diagnostics
+{
+    IsoTp* isoTp;
+    FreezeFrame* freeze;
+    FaultLog* faultLog;
+    SafetyChecker* sc;
+    StackMonitor* stack;
+    TorqueMap* map;
+    MotorController* mcm;
+
+    //Response being sent: a fixed header, then a body that's read from its owner as it goes out
+    ubyte1 service;
+    ubyte1 header[DIAG_HEADER_MAX];
+    ubyte1 headerLength;
+    ubyte1 mode;                    //Torque map mode
+    ubyte2 oldestRecord;            //Fault records: ring index the dump starts at
+    ubyte1 record[FAULTLOG_RECORD_BYTES];
+    ubyte2 recordLoaded;            //Ring index in record[], 0xFFFF = none
+};
+
+static struct _Diagnostics diagnosticsInstance;
+
+Diagnostics* Diagnostics_new(IsoTp* isoTp, FreezeFrame* freeze, FaultLog* faultLog, SafetyChecker* sc, StackMonitor* stack, TorqueMap* map, MotorController* mcm)
+{
+    Diagnostics* me = &diagnosticsInstance;
+
+    me->isoTp = isoTp;
+    me->freeze = freeze;
+    me->faultLog = faultLog;
+    me->sc = sc;
+    me->stack = stack;
+    me->map = map;
+    me->mcm = mcm;
+
+    me->service = 0;
+    me->headerLength = 0;
+    me->mode = 0;
+    me->oldestRecord = 0;
+    me->recordLoaded = 0xFFFF;
+
+    return me;
+}
+
+static void Diagnostics_put2(ubyte1* data, ubyte2 value)
+{
+    data[0] = (ubyte1)value;
+    data[1] = (ubyte1)(value >> 8);
+}
+
+static void Diagnostics_put4(ubyte1* data, ubyte4 value)
+{
+    data[0] = (ubyte1)value;
+    data[1] = (ubyte1)(value >> 8);
+    data[2] = (ubyte1)(value >> 16);
+    data[3] = (ubyte1)(value >> 24);
+}
+
+//Byte n of the body (after the header).  FALSE = not available yet.
+static bool Diagnostics_bodyByte(Diagnostics* me, ubyte2 n, ubyte1* value)
+{
+    ubyte2 index;
+    ubyte2 record;
+
+    switch (me->service)
+    {
+    case DIAG_FREEZE_FRAME:
+        *value = FreezeFrame_getSample(me->freeze, (ubyte1)(n / FREEZE_SNAPSHOT_BYTES))[n % FREEZE_SNAPSHOT_BYTES];
+        return TRUE;
+
+    case DIAG_FAULT_COUNTS:
+        index = n / 2;
+        index = (index < 32) ? FaultLog_getCount(me->faultLog, FAULTLOG_SOURCE_VCU, (ubyte1)index)
+              : (index < 96) ? FaultLog_getCount(me->faultLog, FAULTLOG_SOURCE_MCM, (ubyte1)(index - 32))
+              : FaultLog_getCount(me->faultLog, FAULTLOG_SOURCE_BMS, (ubyte1)(index - 96));
+        *value = (n % 2 == 0) ? (ubyte1)index : (ubyte1)(index >> 8);
+        return TRUE;
+
+    case DIAG_FAULT_RECORDS:
+        record = (me->oldestRecord + n / FAULTLOG_RECORD_BYTES) % FAULTLOG_RECORDS;
+        if (record != me->recordLoaded)
+        {
+            if (FaultLog_readRecord(me->faultLog, record, me->record) == FALSE)
+            {
+                return FALSE;
+            }
+            me->recordLoaded = record;
+        }
+        *value = me->record[n % FAULTLOG_RECORD_BYTES];
+        return TRUE;
+
+    case DIAG_PROFILING:
+        index = SafetyChecker_getRuleMaxUs(me->sc, (ubyte1)(n / 3));
+        *value = (n % 3 == 0) ? (ubyte1)SafetyChecker_getRuleFlag(me->sc, (ubyte1)(n / 3))
+               : (n % 3 == 1) ? (ubyte1)index
+               : (ubyte1)(index >> 8);
+        return TRUE;
+
+    case DIAG_TORQUEMAP_READ:
+        index = (ubyte2)TorqueMap_getCell(me->map, me->mode, (ubyte1)(n / 2 / TORQUEMAP_PEDAL_POINTS), (ubyte1)(n / 2 % TORQUEMAP_PEDAL_POINTS));
+        *value = (n % 2 == 0) ? (ubyte1)index : (ubyte1)(index >> 8);
+        return TRUE;
+
+    default:
+        return FALSE;
+    }
+}
+
+//IsoTpSource
+static ubyte2 Diagnostics_source(void* object, ubyte2 offset, ubyte1* data, ubyte2 length)
+{
+    Diagnostics* me = (Diagnostics*)object;
+    ubyte2 count = 0;
+
+    for (; count < length; count++, offset++)
+    {
+        if (offset < me->headerLength)
+        {
+            data[count] = me->header[offset];
+        }
+        else if (Diagnostics_bodyByte(me, offset - me->headerLength, &data[count]) == FALSE)
+        {
+            break;
+        }
+    }
+    return count;
+}
+
+static void Diagnostics_respond(Diagnostics* me, ubyte1 service, ubyte2 bodyLength)
+{
+    me->service = service;
+    me->header[0] = service + DIAG_POSITIVE;
+    IsoTp_send(me->isoTp, me->headerLength + bodyLength, Diagnostics_source, me);
+}
+
+static void Diagnostics_reject(Diagnostics* me, ubyte1 service, ubyte1 reason)
+{
+    me->service = 0;
+    me->header[0] = DIAG_NEGATIVE;
+    me->header[1] = service;
+    me->header[2] = reason;
+    me->headerLength = 3;
+    IsoTp_send(me->isoTp, 3, Diagnostics_source, me);
+}
+
+static void Diagnostics_writeTorqueMap(Diagnostics* me, const ubyte1* request, ubyte2 length)
+{
+    TorqueMapTable table;
+    const ubyte1* cell = &request[2];
+
+    if (length != 2 + DIAG_TORQUEMAP_CELLS * 2)
+    {
+        Diagnostics_reject(me, request[0], DIAG_NRC_LENGTH);
+        return;
+    }
+    //The table in use can't change under the driver
+    if (MCM_getStartupStage(me->mcm) >= MCM_STAGE_WAIT_INVERTER)
+    {
+        Diagnostics_reject(me, request[0], DIAG_NRC_CONDITIONS);
+        return;
+    }
+    for (ubyte1 speed = 0; speed < TORQUEMAP_SPEED_POINTS; speed++)
+    {
+        for (ubyte1 pedal = 0; pedal < TORQUEMAP_PEDAL_POINTS; pedal++, cell += 2)
+        {
+            table[speed][pedal] = (sbyte2)((ubyte2)cell[0] | ((ubyte2)cell[1] << 8));
+        }
+    }
+    if (TorqueMap_load(me->map, request[1], table) == FALSE)
+    {
+        Diagnostics_reject(me, request[0], DIAG_NRC_RANGE);
+        return;
+    }
+    me->header[1] = request[1];
+    me->headerLength = 2;
+    Diagnostics_respond(me, DIAG_TORQUEMAP_WRITE, 0);
+}
+
+void Diagnostics_update(Diagnostics* me)
+{
+    const ubyte1* request;
+    ubyte2 length;
+    ubyte1 rules;
+
+    //Leave a new request in IsoTp until the last response is out
+    if (IsoTp_isBusy(me->isoTp) == TRUE)
+    {
+        return;
+    }
+    length = IsoTp_takeRequest(me->isoTp, &request);
+    if (length == 0)
+    {
+        return;
+    }
+
+    switch (request[0])
+    {
+    case DIAG_FREEZE_FRAME:
+        //Samples go out over several cycles - while still recording, the ring would move under them
+        if (FreezeFrame_getState(me->freeze) != FREEZE_FROZEN)
+        {
+            Diagnostics_reject(me, request[0], DIAG_NRC_CONDITIONS);
+            break;
+        }
+        me->header[1] = FreezeFrame_getState(me->freeze);
+        me->header[2] = FreezeFrame_getSampleCount(me->freeze);
+        me->header[3] = FreezeFrame_getTriggerSample(me->freeze);
+        me->header[4] = FREEZE_PRE_CYCLES;
+        Diagnostics_put4(&me->header[5], FreezeFrame_getTriggerFaults(me->freeze));
+        me->headerLength = 9;
+        Diagnostics_respond(me, DIAG_FREEZE_FRAME, (ubyte2)me->header[2] * FREEZE_SNAPSHOT_BYTES);
+        break;
+
+    case DIAG_FAULT_COUNTS:
+        Diagnostics_put4(&me->header[1], FaultLog_getOperatingSeconds(me->faultLog));
+        Diagnostics_put2(&me->header[5], FaultLog_getSessionEvents(me->faultLog));
+        me->header[7] = FaultLog_getDropped(me->faultLog);
+        me->headerLength = 8;
+        Diagnostics_respond(me, DIAG_FAULT_COUNTS, DIAG_FAULT_CODES * 2);
+        break;
+
+    case DIAG_FAULT_RECORDS:
+        me->oldestRecord = FaultLog_getOldestRecord(me->faultLog);
+        me->recordLoaded = 0xFFFF;
+        me->header[1] = FAULTLOG_RECORD_BYTES;
+        me->header[2] = FAULTLOG_RECORDS;
+        me->headerLength = 3;
+        Diagnostics_respond(me, DIAG_FAULT_RECORDS, FAULTLOG_RECORDS * FAULTLOG_RECORD_BYTES);
+        break;
+
+    case DIAG_PROFILING:
+        rules = SafetyChecker_getRuleCount(me->sc);
+        me->header[1] = rules;
+        Diagnostics_put2(&me->header[2], SafetyChecker_getEvaluationMaxUs(me->sc));
+        Diagnostics_put2(&me->header[4], StackMonitor_getHighWaterBytes(me->stack));
+        Diagnostics_put2(&me->header[6], StackMonitor_getPaintedBytes(me->stack));
+        me->headerLength = 8;
+        Diagnostics_respond(me, DIAG_PROFILING, (ubyte2)rules * 3);
+        break;
+
+    case DIAG_TORQUEMAP_READ:
+        if (length != 2) { Diagnostics_reject(me, request[0], DIAG_NRC_LENGTH); break; }
+        if (request[1] >= TORQUEMAP_MODE_COUNT) { Diagnostics_reject(me, request[0], DIAG_NRC_RANGE); break; }
+        me->mode = request[1];
+        me->header[1] = request[1];
+        me->header[2] = TORQUEMAP_SPEED_POINTS;
+        me->header[3] = TORQUEMAP_PEDAL_POINTS;
+        me->headerLength = 4;
+        Diagnostics_respond(me, DIAG_TORQUEMAP_READ, DIAG_TORQUEMAP_CELLS * 2);
+        break;
+
+    case DIAG_TORQUEMAP_WRITE:
+        Diagnostics_writeTorqueMap(me, request, length);
+        break;
+
+    default:
+        Diagnostics_reject(me, request[0], DIAG_NRC_SERVICE);
+        break;
+    }
+}
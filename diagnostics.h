@@ -0,0 +1,48 @@
+#ifndef _DIAGNOSTICS_H
+#define _DIAGNOSTICS_H
+
+#include "IO_Driver.h"
+#include "isoTp.h"
+#include "freezeFrame.h"
+#include "faultLog.h"
+#include "safety.h"
+#include "stackMonitor.h"
+#include "torqueMap.h"
+#include "motorController.h"
+
+/*****************************************************************************
+* Diagnostics (request/response services over ISO-TP)
+******************************************************************************
+* A request is a service ID plus parameters.  The response is the service ID
+* + 0x40 followed by the data, or 7F <service> <reason> if it can't be done
+* (11 = unknown service, 13 = wrong length, 22 = not now, 31 = out of range).  Multi-byte
+* values are little-endian, same as the single-frame messages.
+*
+*   01       Freeze frame: 41, state, samples, trigger sample, pre cycles,
+*            trigger faults (4), then FREEZE_SNAPSHOT_BYTES per sample, oldest first.
+*            Only once a capture is complete (22 before that) - don't re-arm
+*            until the reply is in.
+*   02       Fault counts: 42, operating seconds (4), events since power-up (2),
+*            dropped (1), then a ubyte2 count per code (VCU 0-31, MCM 0-63, BMS 0-31)
+*   03       Fault records: 43, record bytes, records, then the whole EEPROM
+*            ring oldest slot first (blank slots are FF)
+*   04       Profiling: 44, rule count, slowest table evaluation us (2), stack
+*            high water (2), stack painted (2), then flag (1) + slowest us (2) per rule
+*   05 m     Torque map read: 45, m, speed points, pedal points, then the
+*            cells [speed][pedal] as Q10 sbyte2
+*   06 m ..  Torque map write: the cells in the same order as 05 - reply 46 m.
+*            Refused (22) once the inverter is being enabled, and (31) if a
+*            0% pedal cell is positive.
+*
+* Only one response is built at a time; a request that arrives while the
+* previous response is still going out waits for it.
+****************************************************************************/
+
+typedef struct _Diagnostics Diagnostics;
+
+Diagnostics* Diagnostics_new(IsoTp* isoTp, FreezeFrame* freeze, FaultLog* faultLog, SafetyChecker* sc, StackMonitor* stack, TorqueMap* map, MotorController* mcm);
+
+//Call once per cycle (after CanManager_read on the ISO-TP channel)
+void Diagnostics_update(Diagnostics* me);
+
+#endif //  _DIAGNOSTICS_H
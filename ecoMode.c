@@ -0,0 +1,110 @@
+#include "IO_Driver.h"
+
+#include "ecoMode.h"
+#include "energyEstimator.h"
+
+//Never cap below this - the car still has to get around the track
+#define ECO_MIN_CAP_W 10000
+
+struct _EcoMode
+{
+    ubyte1 totalLaps;
+    sbyte4 reserveJ;
+    ubyte4 defaultLapMs;
+    ubyte2 peakToAveragePercent;
+
+    bool on;
+    ubyte1 lapsRemaining;
+    sbyte4 averageBudgetW;
+    sbyte4 capW;
+    ubyte2 updateCount;
+};
+
+static struct _EcoMode ecoModeInstance;
+
+EcoMode* EcoMode_new(ubyte1 totalLaps, ubyte2 reserveWh, ubyte2 defaultLapSeconds, ubyte2 peakToAveragePercent)
+{
+    EcoMode* me = &ecoModeInstance;
+
+    me->totalLaps = totalLaps;
+    me->reserveJ = (sbyte4)reserveWh * 3600;
+    me->defaultLapMs = (ubyte4)defaultLapSeconds * 1000;
+    me->peakToAveragePercent = peakToAveragePercent;
+
+    me->on = FALSE;
+    me->lapsRemaining = totalLaps;
+    me->averageBudgetW = 0;
+    me->capW = ECO_NO_CAP_W;
+    me->updateCount = 0;
+
+    return me;
+}
+
+void EcoMode_toggle(EcoMode* me)
+{
+    me->on = (me->on == TRUE) ? FALSE : TRUE;
+    me->updateCount++;
+}
+
+void EcoMode_update(EcoMode* me, EnergyEstimator* energy)
+{
+    sbyte4 usableJ;
+    ubyte4 lapMs;
+    ubyte4 currentLapMs;
+    ubyte4 remainingMs;
+    sbyte4 capW;
+
+    me->lapsRemaining = (EnergyEstimator_getLapCount(energy) >= me->totalLaps) ? 0 : me->totalLaps - EnergyEstimator_getLapCount(energy);
+
+    if (me->on == FALSE || me->lapsRemaining == 0)
+    {
+        capW = ECO_NO_CAP_W;
+    }
+    else
+    {
+        usableJ = (sbyte4)EnergyEstimator_getRemainingWh(energy) * 3600 - me->reserveJ;
+        lapMs = (EnergyEstimator_getLastLapMs(energy) > 0) ? EnergyEstimator_getLastLapMs(energy) : me->defaultLapMs;
+        currentLapMs = EnergyEstimator_getCurrentLapMs(energy);
+
+        //Time left = laps to go minus time into this lap, but never less than a tenth of a lap
+        //(an overrunning lap would otherwise drive it toward 0 and open the cap right up)
+        remainingMs = lapMs * me->lapsRemaining;
+        remainingMs = (currentLapMs + lapMs / 10 < remainingMs) ? remainingMs - currentLapMs : lapMs / 10;
+
+        //J / s = W (whole seconds are plenty - there are minutes left)
+        me->averageBudgetW = (usableJ <= 0) ? 0 : usableJ / (sbyte4)(remainingMs / 1000 + 1);
+        capW = me->averageBudgetW / 100 * me->peakToAveragePercent;
+        if (capW < ECO_MIN_CAP_W) { capW = ECO_MIN_CAP_W; }
+    }
+
+    if (capW != me->capW)
+    {
+        me->capW = capW;
+        me->updateCount++;
+    }
+}
+
+bool EcoMode_isOn(EcoMode* me)
+{
+    return me->on;
+}
+
+sbyte4 EcoMode_getPowerCapW(EcoMode* me)
+{
+    return me->capW;
+}
+
+sbyte4 EcoMode_getAveragePowerBudgetW(EcoMode* me)
+{
+    return me->averageBudgetW;
+}
+
+ubyte1 EcoMode_getLapsRemaining(EcoMode* me)
+{
+    return me->lapsRemaining;
+}
+
+ubyte2 EcoMode_getUpdateCount(EcoMode* me)
+{
+    return me->updateCount;
+}
@@ -0,0 +1,38 @@
+#ifndef _ECOMODE_H
+#define _ECOMODE_H
+
+#include "IO_Driver.h"
+#include "energyEstimator.h"
+
+/*****************************************************************************
+* Eco Mode (endurance energy budget)
+******************************************************************************
+* Toggled with a short Eco button press.  While on, it caps tractive power so
+* the energy left (minus a reserve) lasts for the laps left:
+*
+*   average power allowed = (remaining energy - reserve) / time left
+*   time left             = laps left x lap time - time into this lap
+*   power cap             = average power allowed x peak-to-average ratio
+*
+* Lap time is the last lap's (or the configured default before the first lap
+* marker).  The cap is fed to the PowerLimiter as its target, so the limiter
+* does the actual torque reduction.  Cheap enough to call every cycle: a
+* handful of integer divides.
+****************************************************************************/
+
+typedef struct _EcoMode EcoMode;
+
+EcoMode* EcoMode_new(ubyte1 totalLaps, ubyte2 reserveWh, ubyte2 defaultLapSeconds, ubyte2 peakToAveragePercent);
+
+void EcoMode_toggle(EcoMode* me);
+void EcoMode_update(EcoMode* me, EnergyEstimator* energy);
+
+bool EcoMode_isOn(EcoMode* me);
+sbyte4 EcoMode_getPowerCapW(EcoMode* me);         //ECO_NO_CAP_W when off
+sbyte4 EcoMode_getAveragePowerBudgetW(EcoMode* me);
+ubyte1 EcoMode_getLapsRemaining(EcoMode* me);
+ubyte2 EcoMode_getUpdateCount(EcoMode* me);
+
+#define ECO_NO_CAP_W 0x7FFFFFFF
+
+#endif //  _ECOMODE_H
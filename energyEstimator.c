@@ -0,0 +1,197 @@
+#include "IO_Driver.h"
+#include "IO_RTC.h"
+#include "IO_CAN.h"
+
+#include "energyEstimator.h"
+#include "bms.h"
+
+//Longest gap between 0x629s that gets integrated - past this, the BMS was probably
+//offline and the last power reading says nothing about the gap
+#define ENERGY_MAX_GAP_MS 1000
+
+//How far each BMS SOC change pulls the estimate toward the BMS (1/2^n of the difference)
+#define ENERGY_SOC_CORRECTION_SHIFT 3
+
+struct _EnergyEstimator
+{
+    BatteryManagementSystem* bms;
+    sbyte4 packEnergyJ;
+
+    //Energy used since startup: whole J plus leftover mJ
+    sbyte4 usedJ;
+    sbyte4 usedRemainder_mJ;
+    sbyte4 remainingJ;
+    bool socInitialized;
+    ubyte1 lastBmsSOC;
+
+    ubyte4 timestamp_lastPower;
+    bool havePowerTimestamp;
+
+    ubyte4 timestamp_lapStart;
+    sbyte4 lapStartUsedJ;
+    ubyte1 lapCount;
+    sbyte4 lastLapJ;
+    ubyte4 lastLapMs;
+
+    ubyte2 updateCount;
+};
+
+static struct _EnergyEstimator energyEstimatorInstance;
+
+EnergyEstimator* EnergyEstimator_new(BatteryManagementSystem* bms, ubyte2 packEnergyWh)
+{
+    EnergyEstimator* me = &energyEstimatorInstance;
+
+    me->bms = bms;
+    me->packEnergyJ = (sbyte4)packEnergyWh * 3600;
+
+    me->usedJ = 0;
+    me->usedRemainder_mJ = 0;
+    me->remainingJ = me->packEnergyJ;  //Until the BMS reports SOC
+    me->socInitialized = FALSE;
+    me->lastBmsSOC = 0;
+
+    me->havePowerTimestamp = FALSE;
+
+    IO_RTC_StartTime(&me->timestamp_lapStart);
+    me->lapStartUsedJ = 0;
+    me->lapCount = 0;
+    me->lastLapJ = 0;
+    me->lastLapMs = 0;
+
+    me->updateCount = 0;
+
+    return me;
+}
+
+static void EnergyEstimator_integrate(EnergyEstimator* me)
+{
+    sbyte4 powerW = BMS_getPower(me->bms);  //Positive = discharge
+    ubyte4 elapsedMs;
+    sbyte4 energy_mJ;
+
+    if (me->havePowerTimestamp == FALSE)
+    {
+        me->havePowerTimestamp = TRUE;
+        IO_RTC_StartTime(&me->timestamp_lastPower);
+        return;
+    }
+
+    elapsedMs = IO_RTC_GetTimeUS(me->timestamp_lastPower) / 1000;
+    IO_RTC_StartTime(&me->timestamp_lastPower);
+    if (elapsedMs > ENERGY_MAX_GAP_MS)
+    {
+        return;
+    }
+
+    //W x ms = mJ.  Carry whole joules out of the remainder.
+    energy_mJ = powerW * (sbyte4)elapsedMs + me->usedRemainder_mJ;
+    me->usedJ += energy_mJ / 1000;
+    me->remainingJ -= energy_mJ / 1000;
+    me->usedRemainder_mJ = energy_mJ % 1000;
+
+    me->updateCount++;
+}
+
+static void EnergyEstimator_correctSOC(EnergyEstimator* me)
+{
+    ubyte1 soc = BMS_getSOC(me->bms);
+    //BMS SOC is truncated to whole %, so aim for the middle of its 1% step
+    sbyte4 bmsRemainingJ = me->packEnergyJ / 1000 * (soc * 10 + 5);
+
+    if (me->socInitialized == FALSE)
+    {
+        me->socInitialized = TRUE;
+        me->remainingJ = bmsRemainingJ;
+    }
+    else if (soc != me->lastBmsSOC)
+    {
+        me->remainingJ += (bmsRemainingJ - me->remainingJ) >> ENERGY_SOC_CORRECTION_SHIFT;
+    }
+    else
+    {
+        return;
+    }
+    me->lastBmsSOC = soc;
+    me->updateCount++;
+}
+
+static void EnergyEstimator_endLap(EnergyEstimator* me)
+{
+    me->lastLapJ = me->usedJ - me->lapStartUsedJ;
+    me->lastLapMs = IO_RTC_GetTimeUS(me->timestamp_lapStart) / 1000;
+    me->lapStartUsedJ = me->usedJ;
+    IO_RTC_StartTime(&me->timestamp_lapStart);
+    me->lapCount++;
+    me->updateCount++;
+}
+
+void EnergyEstimator_parseCanMessage(EnergyEstimator* me, IO_CAN_DATA_FRAME* canMessage)
+{
+    switch (canMessage->id)
+    {
+    case 0x626:  //BMS SOC
+        EnergyEstimator_correctSOC(me);
+        break;
+
+    case 0x629:  //BMS pack voltage/current
+        EnergyEstimator_integrate(me);
+        break;
+
+    case 0x5FE:  //Lap marker / lap count from the dash
+        if (canMessage->length >= 2 && canMessage->data[0] == 0x02)
+        {
+            me->lapCount = canMessage->data[1];
+            me->updateCount++;
+            break;
+        }
+        EnergyEstimator_endLap(me);
+        if (canMessage->length >= 2 && canMessage->data[0] == 0x01)
+        {
+            me->lapCount = canMessage->data[1];
+        }
+        break;
+    }
+}
+
+ubyte2 EnergyEstimator_getRemainingWh(EnergyEstimator* me)
+{
+    return (me->remainingJ <= 0) ? 0 : (ubyte2)(me->remainingJ / 3600);
+}
+
+ubyte1 EnergyEstimator_getSOCPercent(EnergyEstimator* me)
+{
+    sbyte4 percent = (me->packEnergyJ <= 0 || me->remainingJ <= 0) ? 0 : me->remainingJ / (me->packEnergyJ / 100);
+    return (percent > 100) ? 100 : (ubyte1)percent;
+}
+
+ubyte2 EnergyEstimator_getLastLapWh(EnergyEstimator* me)
+{
+    return (me->lastLapJ <= 0) ? 0 : (ubyte2)(me->lastLapJ / 3600);
+}
+
+ubyte2 EnergyEstimator_getLastLapAveragePowerW100(EnergyEstimator* me)
+{
+    //J / ms = kW, so x10 for 0.1 kW
+    return (me->lastLapMs == 0 || me->lastLapJ <= 0) ? 0 : (ubyte2)(me->lastLapJ * 10 / (sbyte4)me->lastLapMs);
+}
+
+ubyte4 EnergyEstimator_getLastLapMs(EnergyEstimator* me)
+{
+    return me->lastLapMs;
+}
+
+ubyte4 EnergyEstimator_getCurrentLapMs(EnergyEstimator* me)
+{
+    return IO_RTC_GetTimeUS(me->timestamp_lapStart) / 1000;
+}
+
+ubyte1 EnergyEstimator_getLapCount(EnergyEstimator* me)
+{
+    return me->lapCount;
+}
+
+ubyte2 EnergyEstimator_getUpdateCount(EnergyEstimator* me)
+{
+    return me->updateCount;
+}
@@ -0,0 +1,45 @@
+#ifndef _ENERGYESTIMATOR_H
+#define _ENERGYESTIMATOR_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+#include "bms.h"
+
+/*****************************************************************************
+* Energy Estimator
+******************************************************************************
+* Tracks pack energy on the VCU for endurance strategy:
+*   - Integrates pack power (BMS V x I) every time 0x629 arrives, using the
+*     actual time between messages.
+*   - Corrects the integrated value toward the BMS's SOC (0x626, whole %)
+*     whenever that SOC changes, so integration drift can't build up.
+*   - A lap marker frame (0x5FE) closes the current lap and records its
+*     energy, time and average power.
+*
+* 0x5FE byte 0:
+*   0x01 = lap marker, byte 1 = laps completed including this one
+*   0x02 = lap count only (no lap ended), byte 1 = laps completed
+*   anything else (or no data) = lap marker, count goes up by one
+* The lap count lives in RAM only, so after a power cycle (driver change) it
+* starts from 0 again.  The dash knows the real count and sends 0x02 when
+* the VCU comes back (and 0x01 with every lap), which puts it right.
+*
+* Messages are routed here by CanManager (CanManager_addEnergyEstimator),
+* after the BMS has already decoded them.
+****************************************************************************/
+
+typedef struct _EnergyEstimator EnergyEstimator;
+
+EnergyEstimator* EnergyEstimator_new(BatteryManagementSystem* bms, ubyte2 packEnergyWh);
+void EnergyEstimator_parseCanMessage(EnergyEstimator* me, IO_CAN_DATA_FRAME* canMessage);
+
+ubyte2 EnergyEstimator_getRemainingWh(EnergyEstimator* me);
+ubyte1 EnergyEstimator_getSOCPercent(EnergyEstimator* me);
+ubyte2 EnergyEstimator_getLastLapWh(EnergyEstimator* me);
+ubyte2 EnergyEstimator_getLastLapAveragePowerW100(EnergyEstimator* me);  //0.1 kW
+ubyte4 EnergyEstimator_getLastLapMs(EnergyEstimator* me);     //0 until the first lap marker
+ubyte4 EnergyEstimator_getCurrentLapMs(EnergyEstimator* me);  //Time since the last lap marker (or startup)
+ubyte1 EnergyEstimator_getLapCount(EnergyEstimator* me);  //Laps completed
+ubyte2 EnergyEstimator_getUpdateCount(EnergyEstimator* me);
+
+#endif //  _ENERGYESTIMATOR_H
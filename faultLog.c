@@ -0,0 +1,464 @@
+#include "IO_Driver.h"
+#include "IO_RTC.h"
+#include "IO_EEPROM.h"
+
+#include "faultLog.h"
+#include "motorController.h"
+#include "bms.h"
+#include "safety.h"
+
+//Counter index = source base + code
+#define FAULTLOG_VCU_CODES 32
+#define FAULTLOG_MCM_CODES 64
+#define FAULTLOG_BMS_CODES 32
+#define FAULTLOG_CODES (FAULTLOG_VCU_CODES + FAULTLOG_MCM_CODES + FAULTLOG_BMS_CODES)
+
+//Summary slot: 0-3 = save sequence, 4-7 = operating seconds, then a ubyte2 count per code, then checksum
+#define FAULTLOG_SUMMARY_BYTES (8 + FAULTLOG_CODES * 2 + 1)
+
+#define FAULTLOG_QUEUE 8            //Events waiting in RAM to be written
+#define FAULTLOG_BATCH 4            //Write as soon as this many are waiting...
+#define FAULTLOG_BATCH_WAIT_US 1000000  //...or the oldest has waited this long
+#define FAULTLOG_COUNTS_SAVE_S 10   //Save the summary this long after a count changes
+#define FAULTLOG_HOURS_SAVE_S 360   //Save operating time at least this often (0.1 h)
+#define FAULTLOG_READ_TIMEOUT_US 100000
+
+//Bigger of a summary and a batch of records
+#define FAULTLOG_BUFFER_BYTES FAULTLOG_SUMMARY_BYTES
+
+struct _FaultLog
+{
+    ubyte2 counts[FAULTLOG_CODES];
+    ubyte4 operatingSeconds;
+    ubyte4 operatingUs;             //Fraction of a second not yet counted
+    ubyte4 timestamp_operating;
+
+    ubyte2 nextSequence;
+    ubyte2 nextRecord;              //Ring index the next record goes to
+    ubyte2 newestRecord;            //0xFFFF = none yet
+    ubyte4 summarySequence;
+    ubyte1 nextSummarySlot;
+    bool countsDirty;
+    ubyte4 summarySavedSeconds;     //operatingSeconds at the last summary save
+    ubyte4 countsChangedSeconds;
+
+    ubyte1 queue[FAULTLOG_QUEUE][FAULTLOG_RECORD_BYTES];
+    ubyte1 queued;
+    ubyte4 timestamp_oldestQueued;
+    ubyte1 dropped;
+
+    //EEPROM_Write works in the background, so what's being written has to stay put until it's done
+    ubyte1 buffer[FAULTLOG_BUFFER_BYTES];
+
+    //Diagnostic reads (same for EEPROM_Read)
+    ubyte1 readCache[FAULTLOG_READ_RECORDS][FAULTLOG_RECORD_BYTES];
+    ubyte2 readCacheFirst;          //First ring index in readCache, 0xFFFF = nothing good in it
+    ubyte2 readWanted;              //First ring index to read next, 0xFFFF = nothing wanted
+    ubyte2 readInProgress;          //First ring index being read now, 0xFFFF = no read running
+
+    ubyte4 lastVcuFaults;
+    ubyte4 lastMcmFaults[2];
+    ubyte1 lastBmsFault;
+
+    ubyte2 sessionEvents;
+    ubyte1 lastSource;
+    ubyte1 lastCode;
+    ubyte2 updateCount;
+};
+
+static struct _FaultLog faultLogInstance;
+
+static ubyte1 FaultLog_checksum(const ubyte1* data, ubyte2 length)
+{
+    ubyte1 sum = 0xA5;  //So all-zero data doesn't pass
+    for (ubyte2 i = 0; i < length; i++)
+    {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static ubyte4 FaultLog_get4(const ubyte1* data)
+{
+    return (ubyte4)data[0] | ((ubyte4)data[1] << 8) | ((ubyte4)data[2] << 16) | ((ubyte4)data[3] << 24);
+}
+
+static void FaultLog_put4(ubyte1* data, ubyte4 value)
+{
+    data[0] = (ubyte1)value;
+    data[1] = (ubyte1)(value >> 8);
+    data[2] = (ubyte1)(value >> 16);
+    data[3] = (ubyte1)(value >> 24);
+}
+
+//Startup only
+static bool FaultLog_readBlocking(ubyte2 address, ubyte2 length, ubyte1* data)
+{
+    ubyte4 timestamp_read;
+
+    if (IO_EEPROM_Read(address, length, data) != IO_E_OK)
+    {
+        return FALSE;
+    }
+    IO_RTC_StartTime(&timestamp_read);
+    while (IO_EEPROM_GetStatus() == IO_E_BUSY)
+    {
+        if (IO_RTC_GetTimeUS(timestamp_read) > FAULTLOG_READ_TIMEOUT_US)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static void FaultLog_loadSummary(FaultLog* me)
+{
+    ubyte4 bestSequence = 0;
+    sbyte1 bestSlot = -1;
+    ubyte4 sequence;
+
+    for (ubyte1 slot = 0; slot < FAULTLOG_SUMMARY_SLOTS; slot++)
+    {
+        if (FaultLog_readBlocking(FAULTLOG_SUMMARY_START + slot * FAULTLOG_SUMMARY_SLOT_BYTES, FAULTLOG_SUMMARY_BYTES, me->buffer) == TRUE
+            && FaultLog_checksum(me->buffer, FAULTLOG_SUMMARY_BYTES - 1) == me->buffer[FAULTLOG_SUMMARY_BYTES - 1])
+        {
+            sequence = FaultLog_get4(me->buffer);
+            if (bestSlot < 0 || sequence > bestSequence)
+            {
+                bestSequence = sequence;
+                bestSlot = slot;
+            }
+        }
+    }
+
+    if (bestSlot < 0)
+    {
+        return;  //Blank/corrupt - start from zero
+    }
+
+    FaultLog_readBlocking(FAULTLOG_SUMMARY_START + bestSlot * FAULTLOG_SUMMARY_SLOT_BYTES, FAULTLOG_SUMMARY_BYTES, me->buffer);
+    me->summarySequence = bestSequence + 1;
+    me->nextSummarySlot = (bestSlot + 1) % FAULTLOG_SUMMARY_SLOTS;
+    me->operatingSeconds = FaultLog_get4(&me->buffer[4]);
+    for (ubyte2 code = 0; code < FAULTLOG_CODES; code++)
+    {
+        me->counts[code] = (ubyte2)me->buffer[8 + code * 2] | ((ubyte2)me->buffer[9 + code * 2] << 8);
+    }
+}
+
+//Finds the newest good record so writing carries on after it
+static void FaultLog_findNewestRecord(FaultLog* me)
+{
+    const ubyte2 recordsPerRead = FAULTLOG_BUFFER_BYTES / FAULTLOG_RECORD_BYTES;
+    ubyte1* record;
+    ubyte2 sequence;
+    ubyte2 newestSequence = 0;
+
+    for (ubyte2 first = 0; first < FAULTLOG_RECORDS; first += recordsPerRead)
+    {
+        ubyte2 count = (FAULTLOG_RECORDS - first < recordsPerRead) ? FAULTLOG_RECORDS - first : recordsPerRead;
+        if (FaultLog_readBlocking(FAULTLOG_EEPROM_START + first * FAULTLOG_RECORD_BYTES, count * FAULTLOG_RECORD_BYTES, me->buffer) == FALSE)
+        {
+            continue;
+        }
+        for (ubyte2 i = 0; i < count; i++)
+        {
+            record = &me->buffer[i * FAULTLOG_RECORD_BYTES];
+            sequence = (ubyte2)record[0] | ((ubyte2)record[1] << 8);
+            if (sequence == 0xFFFF || FaultLog_checksum(record, FAULTLOG_RECORD_BYTES - 1) != record[FAULTLOG_RECORD_BYTES - 1])
+            {
+                continue;
+            }
+            //Sequence numbers wrap, so "newer" = ahead by less than half the range
+            if (me->newestRecord == 0xFFFF || (sbyte2)(sequence - newestSequence) > 0)
+            {
+                newestSequence = sequence;
+                me->newestRecord = first + i;
+            }
+        }
+    }
+
+    if (me->newestRecord != 0xFFFF)
+    {
+        me->nextSequence = (newestSequence + 1 == 0xFFFF) ? 0 : newestSequence + 1;
+        me->nextRecord = (me->newestRecord + 1) % FAULTLOG_RECORDS;
+    }
+}
+
+FaultLog* FaultLog_new(void)
+{
+    FaultLog* me = &faultLogInstance;
+
+    for (ubyte2 code = 0; code < FAULTLOG_CODES; code++)
+    {
+        me->counts[code] = 0;
+    }
+    me->operatingSeconds = 0;
+    me->operatingUs = 0;
+    me->nextSequence = 0;
+    me->nextRecord = 0;
+    me->newestRecord = 0xFFFF;
+    me->summarySequence = 0;
+    me->nextSummarySlot = 0;
+    me->countsDirty = FALSE;
+    me->queued = 0;
+    me->timestamp_oldestQueued = 0;
+    me->dropped = 0;
+    me->readCacheFirst = 0xFFFF;
+    me->readWanted = 0xFFFF;
+    me->readInProgress = 0xFFFF;
+
+    //Faults already there on the first cycle (not calibrated yet, etc) aren't logged
+    me->lastVcuFaults = 0xFFFFFFFF;
+    me->lastMcmFaults[0] = 0;
+    me->lastMcmFaults[1] = 0;
+    me->lastBmsFault = 0;
+
+    me->sessionEvents = 0;
+    me->lastSource = 0xFF;
+    me->lastCode = 0xFF;
+    me->updateCount = 0;
+
+    IO_EEPROM_Init();
+    FaultLog_loadSummary(me);
+    FaultLog_findNewestRecord(me);
+    me->summarySavedSeconds = me->operatingSeconds;
+    me->countsChangedSeconds = me->operatingSeconds;
+
+    IO_RTC_StartTime(&me->timestamp_operating);
+    return me;
+}
+
+static void FaultLog_event(FaultLog* me, FaultLogSource source, ubyte1 code, ubyte4 faultWord)
+{
+    ubyte2 index = (source == FAULTLOG_SOURCE_VCU) ? code
+                 : (source == FAULTLOG_SOURCE_MCM) ? FAULTLOG_VCU_CODES + code
+                 : FAULTLOG_VCU_CODES + FAULTLOG_MCM_CODES + ((code < FAULTLOG_BMS_CODES) ? code : FAULTLOG_BMS_CODES - 1);
+    ubyte1* record;
+
+    if (me->counts[index] < 0xFFFF) { me->counts[index]++; }
+    if (me->countsDirty == FALSE) { me->countsChangedSeconds = me->operatingSeconds; }
+    me->countsDirty = TRUE;
+    me->sessionEvents++;
+    me->lastSource = source;
+    me->lastCode = code;
+    me->updateCount++;
+
+    if (me->queued >= FAULTLOG_QUEUE)
+    {
+        if (me->dropped < 0xFF) { me->dropped++; }
+        return;
+    }
+    if (me->queued == 0) { IO_RTC_StartTime(&me->timestamp_oldestQueued); }
+
+    record = me->queue[me->queued++];
+    record[0] = (ubyte1)me->nextSequence;
+    record[1] = (ubyte1)(me->nextSequence >> 8);
+    record[2] = source;
+    record[3] = code;
+    FaultLog_put4(&record[4], me->operatingSeconds);
+    record[8] = (ubyte1)me->counts[index];
+    record[9] = (ubyte1)(me->counts[index] >> 8);
+    FaultLog_put4(&record[10], faultWord);
+    record[14] = 0;
+    record[15] = FaultLog_checksum(record, FAULTLOG_RECORD_BYTES - 1);
+
+    me->nextSequence = (me->nextSequence + 1 == 0xFFFF) ? 0 : me->nextSequence + 1;
+}
+
+//One event per bit that wasn't set last time
+static void FaultLog_newBits(FaultLog* me, FaultLogSource source, ubyte1 firstCode, ubyte4 bits, ubyte4 lastBits)
+{
+    ubyte4 newBits = bits & ~lastBits;
+    for (ubyte1 bit = 0; newBits != 0; bit++, newBits >>= 1)
+    {
+        if (newBits & 1) { FaultLog_event(me, source, firstCode + bit, bits); }
+    }
+}
+
+//Starts at most one EEPROM read or write, never waits for one
+static void FaultLog_write(FaultLog* me)
+{
+    ubyte1 count;
+
+    if (IO_EEPROM_GetStatus() == IO_E_BUSY)
+    {
+        return;
+    }
+
+    if (me->readInProgress != 0xFFFF)
+    {
+        me->readCacheFirst = me->readInProgress;
+        me->readInProgress = 0xFFFF;
+    }
+
+    //Reads go first - someone is waiting on them
+    if (me->readWanted != 0xFFFF)
+    {
+        if (IO_EEPROM_Read(FAULTLOG_EEPROM_START + me->readWanted * FAULTLOG_RECORD_BYTES
+                           , FAULTLOG_READ_RECORDS * FAULTLOG_RECORD_BYTES, me->readCache[0]) == IO_E_OK)
+        {
+            me->readCacheFirst = 0xFFFF;
+            me->readInProgress = me->readWanted;
+            me->readWanted = 0xFFFF;
+        }
+        return;
+    }
+
+    if (me->queued >= FAULTLOG_BATCH
+        || (me->queued > 0 && IO_RTC_GetTimeUS(me->timestamp_oldestQueued) >= FAULTLOG_BATCH_WAIT_US))
+    {
+        //One write can't wrap past the end of the ring - the rest go next time
+        count = (me->queued < FAULTLOG_RECORDS - me->nextRecord) ? me->queued : (ubyte1)(FAULTLOG_RECORDS - me->nextRecord);
+        for (ubyte2 i = 0; i < (ubyte2)count * FAULTLOG_RECORD_BYTES; i++)
+        {
+            me->buffer[i] = me->queue[i / FAULTLOG_RECORD_BYTES][i % FAULTLOG_RECORD_BYTES];
+        }
+        if (IO_EEPROM_Write(FAULTLOG_EEPROM_START + me->nextRecord * FAULTLOG_RECORD_BYTES, count * FAULTLOG_RECORD_BYTES, me->buffer) == IO_E_OK)
+        {
+            me->readCacheFirst = 0xFFFF;  //Might have just changed
+            me->newestRecord = (me->nextRecord + count - 1) % FAULTLOG_RECORDS;
+            me->nextRecord = (me->nextRecord + count) % FAULTLOG_RECORDS;
+            for (ubyte1 i = count; i < me->queued; i++)
+            {
+                for (ubyte1 b = 0; b < FAULTLOG_RECORD_BYTES; b++) { me->queue[i - count][b] = me->queue[i][b]; }
+            }
+            me->queued -= count;
+            IO_RTC_StartTime(&me->timestamp_oldestQueued);
+        }
+        return;
+    }
+
+    if ((me->countsDirty == TRUE && me->operatingSeconds - me->countsChangedSeconds >= FAULTLOG_COUNTS_SAVE_S)
+        || me->operatingSeconds - me->summarySavedSeconds >= FAULTLOG_HOURS_SAVE_S)
+    {
+        FaultLog_put4(&me->buffer[0], me->summarySequence);
+        FaultLog_put4(&me->buffer[4], me->operatingSeconds);
+        for (ubyte2 code = 0; code < FAULTLOG_CODES; code++)
+        {
+            me->buffer[8 + code * 2] = (ubyte1)me->counts[code];
+            me->buffer[9 + code * 2] = (ubyte1)(me->counts[code] >> 8);
+        }
+        me->buffer[FAULTLOG_SUMMARY_BYTES - 1] = FaultLog_checksum(me->buffer, FAULTLOG_SUMMARY_BYTES - 1);
+
+        if (IO_EEPROM_Write(FAULTLOG_SUMMARY_START + me->nextSummarySlot * FAULTLOG_SUMMARY_SLOT_BYTES, FAULTLOG_SUMMARY_BYTES, me->buffer) == IO_E_OK)
+        {
+            me->summarySequence++;
+            me->nextSummarySlot = (me->nextSummarySlot + 1) % FAULTLOG_SUMMARY_SLOTS;
+            me->summarySavedSeconds = me->operatingSeconds;
+            me->countsDirty = FALSE;
+        }
+    }
+}
+
+void FaultLog_update(FaultLog* me, SafetyChecker* sc, MotorController* mcm, BatteryManagementSystem* bms)
+{
+    ubyte4 vcuFaults = SafetyChecker_getFaults(sc);
+    ubyte4 mcmPost = MCM_getPostFaults(mcm);
+    ubyte4 mcmRun = MCM_getRunFaults(mcm);
+    ubyte1 bmsFault = BMS_getFaultCode(bms);
+
+    //Operating time (RTC timestamps wrap after ~71 minutes, so keep adding it up)
+    me->operatingUs += IO_RTC_GetTimeUS(me->timestamp_operating);
+    IO_RTC_StartTime(&me->timestamp_operating);
+    while (me->operatingUs >= 1000000)
+    {
+        me->operatingUs -= 1000000;
+        me->operatingSeconds++;
+    }
+
+    if (vcuFaults != me->lastVcuFaults)
+    {
+        FaultLog_newBits(me, FAULTLOG_SOURCE_VCU, 0, vcuFaults, me->lastVcuFaults);
+        me->lastVcuFaults = vcuFaults;
+    }
+    if (mcmPost != me->lastMcmFaults[0] || mcmRun != me->lastMcmFaults[1])
+    {
+        FaultLog_newBits(me, FAULTLOG_SOURCE_MCM, 0, mcmPost, me->lastMcmFaults[0]);
+        FaultLog_newBits(me, FAULTLOG_SOURCE_MCM, 32, mcmRun, me->lastMcmFaults[1]);
+        me->lastMcmFaults[0] = mcmPost;
+        me->lastMcmFaults[1] = mcmRun;
+    }
+    if (bmsFault != me->lastBmsFault)
+    {
+        if (bmsFault != 0) { FaultLog_event(me, FAULTLOG_SOURCE_BMS, bmsFault, bmsFault); }
+        me->lastBmsFault = bmsFault;
+    }
+
+    FaultLog_write(me);
+}
+
+ubyte4 FaultLog_getOperatingSeconds(FaultLog* me)
+{
+    return me->operatingSeconds;
+}
+
+ubyte2 FaultLog_getCount(FaultLog* me, FaultLogSource source, ubyte1 code)
+{
+    switch (source)
+    {
+    case FAULTLOG_SOURCE_VCU: return (code < FAULTLOG_VCU_CODES) ? me->counts[code] : 0;
+    case FAULTLOG_SOURCE_MCM: return (code < FAULTLOG_MCM_CODES) ? me->counts[FAULTLOG_VCU_CODES + code] : 0;
+    case FAULTLOG_SOURCE_BMS: return (code < FAULTLOG_BMS_CODES) ? me->counts[FAULTLOG_VCU_CODES + FAULTLOG_MCM_CODES + code] : 0;
+    default: return 0;
+    }
+}
+
+ubyte2 FaultLog_getSessionEvents(FaultLog* me)
+{
+    return me->sessionEvents;
+}
+
+ubyte2 FaultLog_getNewestRecord(FaultLog* me)
+{
+    return me->newestRecord;
+}
+
+ubyte2 FaultLog_getOldestRecord(FaultLog* me)
+{
+    return me->nextRecord;
+}
+
+ubyte1 FaultLog_getLastSource(FaultLog* me)
+{
+    return me->lastSource;
+}
+
+ubyte1 FaultLog_getLastCode(FaultLog* me)
+{
+    return me->lastCode;
+}
+
+ubyte1 FaultLog_getDropped(FaultLog* me)
+{
+    return me->dropped;
+}
+
+ubyte2 FaultLog_getUpdateCount(FaultLog* me)
+{
+    return me->updateCount;
+}
+
+bool FaultLog_readRecord(FaultLog* me, ubyte2 record, ubyte1* data)
+{
+    if (record >= FAULTLOG_RECORDS)
+    {
+        return FALSE;
+    }
+
+    if (me->readCacheFirst != 0xFFFF && record >= me->readCacheFirst && record < me->readCacheFirst + FAULTLOG_READ_RECORDS)
+    {
+        for (ubyte1 b = 0; b < FAULTLOG_RECORD_BYTES; b++)
+        {
+            data[b] = me->readCache[record - me->readCacheFirst][b];
+        }
+        return TRUE;
+    }
+
+    //FAULTLOG_RECORDS is a multiple of FAULTLOG_READ_RECORDS, so a block never wraps
+    if (me->readInProgress == 0xFFFF)
+    {
+        me->readWanted = record - (record % FAULTLOG_READ_RECORDS);
+    }
+    return FALSE;
+}
@@ -0,0 +1,77 @@
+#ifndef _FAULTLOG_H
+#define _FAULTLOG_H
+
+#include "IO_Driver.h"
+#include "motorController.h"
+#include "bms.h"
+#include "safety.h"
+
+/*****************************************************************************
+* Fault Log (persistent, EEPROM 0x1000-0x1FFF)
+******************************************************************************
+* Logs every new VCU fault (SafetyChecker flags 0-31), MCM fault bit (0xAB)
+* and BMS stored fault code.  Each one gets an event record with the
+* operating time it happened at.  Counts per code and total operating time
+* survive power cycles.
+*
+* EEPROM layout:
+*   0x1000-0x17FF  Event ring: FAULTLOG_RECORDS records of 16 bytes, written in
+*                  order and wrapping, so every cell is written equally often.
+*                  The newest record is the one with the highest sequence number.
+*   0x1800-0x1FFF  Summary: FAULTLOG_SUMMARY_SLOTS copies of operating seconds
+*                  + per-code counts.  Each save goes to the next slot, and the
+*                  newest one with a good checksum is loaded at startup.
+*
+* Event record:
+*   0-1 = sequence number (FFFF = blank), 2 = FaultLogSource, 3 = code
+*   (flag/bit number, or BMS stored fault code), 4-7 = operating seconds,
+*   8-9 = times this code has happened (including this one), 10-13 = the
+*   whole fault word it came from, 14 = 0, 15 = checksum
+*
+* Writes: events wait in RAM and are written together (FAULTLOG_BATCH at a
+* time, or sooner if they've waited a second).  The summary is saved a while
+* after counts change and every few minutes for the operating time.  Only one
+* EEPROM write is ever in progress and FaultLog_update never waits for it.
+* Startup (FaultLog_new) reads the log back and does wait.
+*
+* Reads for diagnostics (FaultLog_readRecord) go through a small RAM cache of
+* FAULTLOG_READ_RECORDS records.  A miss queues an EEPROM read, which
+* FaultLog_update starts ahead of any pending write.
+****************************************************************************/
+
+#define FAULTLOG_EEPROM_START 0x1000
+#define FAULTLOG_RECORD_BYTES 16
+#define FAULTLOG_RECORDS 128
+#define FAULTLOG_SUMMARY_START 0x1800
+#define FAULTLOG_SUMMARY_SLOT_BYTES 0x200
+#define FAULTLOG_SUMMARY_SLOTS 4
+#define FAULTLOG_READ_RECORDS 8
+
+typedef enum
+{
+      FAULTLOG_SOURCE_VCU   //SafetyFlag 0-31
+    , FAULTLOG_SOURCE_MCM   //0xAB bit 0-63 (POST 0-31, RUN 32-63)
+    , FAULTLOG_SOURCE_BMS   //storedFaults code (0x622 byte 4)
+} FaultLogSource;
+
+typedef struct _FaultLog FaultLog;
+
+FaultLog* FaultLog_new(void);
+
+//Call once per cycle after SafetyChecker_update
+void FaultLog_update(FaultLog* me, SafetyChecker* sc, MotorController* mcm, BatteryManagementSystem* bms);
+
+ubyte4 FaultLog_getOperatingSeconds(FaultLog* me);  //All time, not just since power-up
+ubyte2 FaultLog_getCount(FaultLog* me, FaultLogSource source, ubyte1 code);  //All time
+ubyte2 FaultLog_getSessionEvents(FaultLog* me);  //Logged since power-up
+ubyte2 FaultLog_getNewestRecord(FaultLog* me);   //Ring index (0-FAULTLOG_RECORDS-1), 0xFFFF = log empty
+ubyte2 FaultLog_getOldestRecord(FaultLog* me);   //Ring index the next record will overwrite
+ubyte1 FaultLog_getLastSource(FaultLog* me);
+ubyte1 FaultLog_getLastCode(FaultLog* me);
+ubyte1 FaultLog_getDropped(FaultLog* me);  //Events lost because the RAM queue was full
+ubyte2 FaultLog_getUpdateCount(FaultLog* me);
+
+//Copies one raw 16-byte record (ring index) out of EEPROM.  FALSE = not read yet, ask again next cycle.
+bool FaultLog_readRecord(FaultLog* me, ubyte2 record, ubyte1* data);
+
+#endif //  _FAULTLOG_H
@@ -0,0 +1,169 @@
+#include "IO_Driver.h"
+
+#include "freezeFrame.h"
+#include "torqueEncoder.h"
+#include "brakePressureSensor.h"
+#include "motorController.h"
+#include "bms.h"
+#include "safety.h"
+
+struct _FreezeFrame
+{
+    ubyte1 samples[FREEZE_SAMPLES][FREEZE_SNAPSHOT_BYTES];
+    ubyte1 next;             //Where the next snapshot goes (= oldest, once full)
+    ubyte1 count;            //Snapshots held (up to FREEZE_SAMPLES)
+    ubyte1 postRemaining;    //Cycles still to record after the fault
+
+    FreezeState state;
+    ubyte4 lastFaults;
+    ubyte4 triggerFaults;
+
+    bool dumping;
+    ubyte1 dumpSample;
+    ubyte2 updateCount;
+};
+
+static struct _FreezeFrame freezeFrameInstance;
+
+FreezeFrame* FreezeFrame_new(void)
+{
+    FreezeFrame* me = &freezeFrameInstance;
+
+    me->lastFaults = 0xFFFFFFFF;  //Faults already there on the first cycle (not calibrated yet, etc) aren't "new"
+    me->dumping = FALSE;
+    me->dumpSample = 0;
+    me->updateCount = 0;
+    FreezeFrame_rearm(me);
+
+    return me;
+}
+
+void FreezeFrame_rearm(FreezeFrame* me)
+{
+    me->next = 0;
+    me->count = 0;
+    me->postRemaining = 0;
+    me->state = FREEZE_RECORDING;
+    me->triggerFaults = 0;
+    me->updateCount++;
+}
+
+static void FreezeFrame_put2(ubyte1* snapshot, ubyte1 offset, ubyte2 value)
+{
+    snapshot[offset] = (ubyte1)value;
+    snapshot[offset + 1] = (ubyte1)(value >> 8);
+}
+
+void FreezeFrame_record(FreezeFrame* me, TorqueEncoder* tps, BrakePressureSensor* bps, MotorController* mcm, BatteryManagementSystem* bms, SafetyChecker* sc)
+{
+    ubyte4 faults = SafetyChecker_getFaults(sc);
+    ubyte4 newFaults = faults & ~me->lastFaults;
+    ubyte1* snapshot;
+
+    me->lastFaults = faults;
+    if (me->state == FREEZE_FROZEN)
+    {
+        return;
+    }
+
+    snapshot = me->samples[me->next];
+    snapshot[0] = (ubyte1)(tps->percent * 100);
+    snapshot[1] = (ubyte1)(bps->percent * 100);
+    FreezeFrame_put2(snapshot, 2, (ubyte2)MCM_commands_getTorque(mcm));
+    FreezeFrame_put2(snapshot, 4, (ubyte2)MCM_getCommandedTorque(mcm));
+    FreezeFrame_put2(snapshot, 6, (ubyte2)MCM_getMotorRPM(mcm));
+    FreezeFrame_put2(snapshot, 8, (ubyte2)(sbyte2)(BMS_getPower(bms) / 100));
+    snapshot[10] = (ubyte1)faults;
+    snapshot[11] = (ubyte1)(faults >> 8);
+    snapshot[12] = (ubyte1)(faults >> 16);
+    snapshot[13] = MCM_getStartupStage(mcm);
+
+    me->next = (me->next + 1 >= FREEZE_SAMPLES) ? 0 : me->next + 1;
+    if (me->count < FREEZE_SAMPLES) { me->count++; }
+
+    if (me->state == FREEZE_RECORDING)
+    {
+        if (newFaults != 0)
+        {
+            me->triggerFaults = newFaults;
+            me->postRemaining = FREEZE_POST_CYCLES;
+            me->state = (FREEZE_POST_CYCLES == 0) ? FREEZE_FROZEN : FREEZE_CAPTURING;
+            me->updateCount++;
+        }
+    }
+    else if (--me->postRemaining == 0)  //FREEZE_CAPTURING
+    {
+        me->state = FREEZE_FROZEN;
+        me->updateCount++;
+    }
+}
+
+void FreezeFrame_parseCanMessage(FreezeFrame* me, IO_CAN_DATA_FRAME* canMessage)
+{
+    if (canMessage->id != 0x5FD || canMessage->length < 1)
+    {
+        return;
+    }
+
+    switch (canMessage->data[0])
+    {
+    case 0xF0:
+        //Only a finished capture holds still while it's sent - ignore the request until then
+        if (me->state == FREEZE_FROZEN)
+        {
+            me->dumping = TRUE;
+            me->dumpSample = 0;
+        }
+        break;
+
+    case 0xF1:
+        me->dumping = FALSE;
+        FreezeFrame_rearm(me);
+        break;
+    }
+}
+
+bool FreezeFrame_nextDumpSample(FreezeFrame* me, ubyte1* sample)
+{
+    if (me->dumping == FALSE || me->state != FREEZE_FROZEN || me->dumpSample >= me->count)
+    {
+        me->dumping = FALSE;
+        return FALSE;
+    }
+    *sample = me->dumpSample++;
+    return TRUE;
+}
+
+FreezeState FreezeFrame_getState(FreezeFrame* me)
+{
+    return me->state;
+}
+
+ubyte4 FreezeFrame_getTriggerFaults(FreezeFrame* me)
+{
+    return me->triggerFaults;
+}
+
+ubyte1 FreezeFrame_getSampleCount(FreezeFrame* me)
+{
+    return me->count;
+}
+
+//Meaningful once frozen: the faulting cycle is followed by FREEZE_POST_CYCLES more
+ubyte1 FreezeFrame_getTriggerSample(FreezeFrame* me)
+{
+    return (me->count > FREEZE_POST_CYCLES) ? me->count - 1 - FREEZE_POST_CYCLES : 0;
+}
+
+const ubyte1* FreezeFrame_getSample(FreezeFrame* me, ubyte1 sample)
+{
+    //Oldest is at "next" once the ring has wrapped, otherwise at 0
+    ubyte1 oldest = (me->count < FREEZE_SAMPLES) ? 0 : me->next;
+    ubyte2 slot = (ubyte2)oldest + sample;
+    return me->samples[(slot >= FREEZE_SAMPLES) ? slot - FREEZE_SAMPLES : slot];
+}
+
+ubyte2 FreezeFrame_getUpdateCount(FreezeFrame* me)
+{
+    return me->updateCount;
+}
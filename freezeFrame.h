@@ -0,0 +1,63 @@
+#ifndef _FREEZEFRAME_H
+#define _FREEZEFRAME_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+#include "torqueEncoder.h"
+#include "brakePressureSensor.h"
+#include "motorController.h"
+#include "bms.h"
+#include "safety.h"
+
+/*****************************************************************************
+* Freeze Frame (fault black box)
+******************************************************************************
+* A small snapshot of inputs and outputs goes into a RAM ring every cycle.
+* When a new fault appears, recording carries on for FREEZE_POST_CYCLES more
+* cycles and then stops.  The ring then holds the FREEZE_PRE_CYCLES before the
+* fault, the faulting cycle, and the cycles after it.  It stays frozen (later
+* faults don't overwrite it) until it's re-armed.
+*
+* Over CAN, on 0x5FD byte 0 (its own ID - 0x5FF byte 1 is the HVIL override):
+*   0xF0 = send the captured snapshots (one per cycle, oldest first - 0x527/0x528).
+*          Ignored unless FREEZE_FROZEN, since the ring still moves before that.
+*   0xF1 = re-arm (clear the capture and start recording again)
+*
+* Snapshot, FREEZE_SNAPSHOT_BYTES:
+*   0 = TPS %, 1 = BPS %, 2-3 = final torque command (DNm), 4-5 = torque
+*   echoed by the MCM (Nm), 6-7 = motor rpm, 8-9 = BMS power (0.1 kW),
+*   10-12 = fault flags 0-23, 13 = MCM startup stage
+****************************************************************************/
+
+#define FREEZE_PRE_CYCLES 24   //~0.8 s of history at the main loop period
+#define FREEZE_POST_CYCLES 8
+#define FREEZE_SAMPLES (FREEZE_PRE_CYCLES + 1 + FREEZE_POST_CYCLES)
+#define FREEZE_SNAPSHOT_BYTES 14
+
+typedef enum
+{
+      FREEZE_RECORDING   //Armed, waiting for a fault
+    , FREEZE_CAPTURING   //Fault seen, recording the cycles after it
+    , FREEZE_FROZEN      //Capture complete
+} FreezeState;
+
+typedef struct _FreezeFrame FreezeFrame;
+
+FreezeFrame* FreezeFrame_new(void);
+
+//Call once per cycle, after the torque command is final
+void FreezeFrame_record(FreezeFrame* me, TorqueEncoder* tps, BrakePressureSensor* bps, MotorController* mcm, BatteryManagementSystem* bms, SafetyChecker* sc);
+void FreezeFrame_parseCanMessage(FreezeFrame* me, IO_CAN_DATA_FRAME* canMessage);  //0x5FD
+void FreezeFrame_rearm(FreezeFrame* me);
+
+FreezeState FreezeFrame_getState(FreezeFrame* me);
+ubyte4 FreezeFrame_getTriggerFaults(FreezeFrame* me);  //Faults that were new in the faulting cycle
+ubyte1 FreezeFrame_getSampleCount(FreezeFrame* me);
+ubyte1 FreezeFrame_getTriggerSample(FreezeFrame* me);  //Index (oldest = 0) of the faulting cycle
+const ubyte1* FreezeFrame_getSample(FreezeFrame* me, ubyte1 sample);  //Oldest = 0
+ubyte2 FreezeFrame_getUpdateCount(FreezeFrame* me);
+
+//Dump requested over CAN: returns the next sample to send (and moves on), or FALSE when done
+bool FreezeFrame_nextDumpSample(FreezeFrame* me, ubyte1* sample);
+
+#endif //  _FREEZEFRAME_H
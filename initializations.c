@@ -91,10 +91,13 @@ void vcu_initializeADC(bool benchMode)
     //TCS Pot
     IO_ADC_ChannelInit(IO_ADC_5V_04, IO_ADC_RESISTIVE, 0, 0, 0, NULL);
 
-    //Unused
-    //IO_ADC_ChannelInit(IO_ADC_5V_05, IO_ADC_RESISTIVE, 0, 0, 0, NULL);
-    //IO_ADC_ChannelInit(IO_ADC_5V_06, IO_ADC_RESISTIVE, 0, 0, 0, NULL);
-    //IO_ADC_ChannelInit(IO_ADC_5V_07, IO_ADC_RESISTIVE, 0, 0, 0, NULL);
+    //Shock pots FR, RL, RR - same channels/mode as the old (commented out) setup.
+    //Resistive, so they don't load the TPS/BPS sensor supplies.
+    //FL (was 5V_04, now the TCS knob) and the steering angle sensor have no
+    //confirmed pin - add them once the harness drawing says where they are.
+    Sensor_WPS_FR.ioErr_signalInit = IO_ADC_ChannelInit(IO_ADC_5V_05, IO_ADC_RESISTIVE, 0, 0, 0, NULL);
+    Sensor_WPS_RL.ioErr_signalInit = IO_ADC_ChannelInit(IO_ADC_5V_06, IO_ADC_RESISTIVE, 0, 0, 0, NULL);
+    Sensor_WPS_RR.ioErr_signalInit = IO_ADC_ChannelInit(IO_ADC_5V_07, IO_ADC_RESISTIVE, 0, 0, 0, NULL);
 
     //----------------------------------------------------------------------------
     //PWD channels
@@ -0,0 +1,332 @@
+#include "IO_Driver.h"
+#include "IO_RTC.h"
+
+#include "isoTp.h"
+
+#define ISOTP_SINGLE 0x0
+#define ISOTP_FIRST 0x1
+#define ISOTP_CONSECUTIVE 0x2
+#define ISOTP_FLOW_CONTROL 0x3
+
+#define ISOTP_FC_CONTINUE 0x0
+#define ISOTP_FC_WAIT 0x1
+#define ISOTP_FC_OVERFLOW 0x2
+#define ISOTP_FC_NONE 0xFF
+
+typedef enum
+{
+      ISOTP_TX_IDLE
+    , ISOTP_TX_FIRST        //send() called, first/single frame not out yet
+    , ISOTP_TX_WAIT_FC      //Waiting for the receiver's flow control
+    , ISOTP_TX_CONSECUTIVE  //Sending consecutive frames
+} IsoTpTxState;
+
+struct _IsoTp
+{
+    ubyte2 rxId;
+    ubyte2 txId;
+
+    //Transmit
+    IsoTpTxState txState;
+    IsoTpSource source;
+    void* sourceObject;
+    ubyte2 txLength;
+    ubyte2 txOffset;                //Bytes sent so far
+    ubyte1 txChunk[7];              //Data for the frame being built (sources may hand it over in pieces)
+    ubyte1 txChunkLength;
+    ubyte1 txSequence;
+    ubyte1 blockSize;               //From the receiver's flow control (0 = no limit)
+    ubyte1 blockRemaining;
+    ubyte4 separationUs;            //STmin
+    ubyte4 timestamp_tx;            //Last frame sent / flow control received
+
+    //Receive
+    ubyte1 rxBuffer[ISOTP_RX_BUFFER];
+    ubyte2 rxLength;
+    ubyte2 rxReceived;
+    bool rxInProgress;
+    ubyte1 rxSequence;
+    ubyte4 timestamp_rx;
+    ubyte2 requestLength;           //Complete request waiting for IsoTp_takeRequest
+    ubyte1 pendingFlowControl;      //Flow control we owe the sender (ISOTP_FC_NONE = nothing)
+
+    ubyte2 errorCount;
+};
+
+static struct _IsoTp isoTpInstance;
+
+IsoTp* IsoTp_new(ubyte2 rxId, ubyte2 txId)
+{
+    IsoTp* me = &isoTpInstance;
+
+    me->rxId = rxId;
+    me->txId = txId;
+
+    me->txState = ISOTP_TX_IDLE;
+    me->source = NULL;
+    me->sourceObject = NULL;
+    me->txLength = 0;
+    me->txOffset = 0;
+    me->txChunkLength = 0;
+    me->txSequence = 0;
+    me->blockSize = 0;
+    me->blockRemaining = 0;
+    me->separationUs = 0;
+    me->timestamp_tx = 0;
+
+    me->rxLength = 0;
+    me->rxReceived = 0;
+    me->rxInProgress = FALSE;
+    me->rxSequence = 0;
+    me->timestamp_rx = 0;
+    me->requestLength = 0;
+    me->pendingFlowControl = ISOTP_FC_NONE;
+
+    me->errorCount = 0;
+
+    return me;
+}
+
+ubyte2 IsoTp_getRxId(IsoTp* me)
+{
+    return me->rxId;
+}
+
+ubyte2 IsoTp_getTxId(IsoTp* me)
+{
+    return me->txId;
+}
+
+static void IsoTp_abortTx(IsoTp* me)
+{
+    me->txState = ISOTP_TX_IDLE;
+    me->errorCount++;
+}
+
+//STmin byte -> us (0x00-0x7F = ms, 0xF1-0xF9 = 100-900 us, anything else = 127 ms per the standard)
+static ubyte4 IsoTp_separationUs(ubyte1 stMin)
+{
+    if (stMin <= 0x7F) { return (ubyte4)stMin * 1000; }
+    if (stMin >= 0xF1 && stMin <= 0xF9) { return (ubyte4)(stMin - 0xF0) * 100; }
+    return 127000;
+}
+
+void IsoTp_parseCanMessage(IsoTp* me, IO_CAN_DATA_FRAME* canMessage)
+{
+    ubyte1* data = canMessage->data;
+    ubyte2 count;
+
+    if (canMessage->id != me->rxId || canMessage->length < 1)
+    {
+        return;
+    }
+
+    switch (data[0] >> 4)
+    {
+    case ISOTP_SINGLE:
+        count = data[0] & 0x0F;
+        if (count >= 1 && count <= 7 && count < canMessage->length)
+        {
+            for (ubyte1 i = 0; i < count; i++) { me->rxBuffer[i] = data[1 + i]; }
+            me->rxInProgress = FALSE;
+            me->requestLength = count;
+        }
+        break;
+
+    case ISOTP_FIRST:
+        if (canMessage->length < 8) { break; }
+        me->rxLength = ((ubyte2)(data[0] & 0x0F) << 8) | data[1];
+        if (me->rxLength < 8)
+        {
+            break;  //Would have fit in a single frame - not valid
+        }
+        if (me->rxLength > ISOTP_RX_BUFFER)
+        {
+            me->rxInProgress = FALSE;
+            me->pendingFlowControl = ISOTP_FC_OVERFLOW;
+            me->errorCount++;
+            break;
+        }
+        for (ubyte1 i = 0; i < 6; i++) { me->rxBuffer[i] = data[2 + i]; }
+        me->rxReceived = 6;
+        me->rxSequence = 1;
+        me->rxInProgress = TRUE;
+        me->pendingFlowControl = ISOTP_FC_CONTINUE;
+        IO_RTC_StartTime(&me->timestamp_rx);
+        break;
+
+    case ISOTP_CONSECUTIVE:
+        if (me->rxInProgress == FALSE) { break; }
+        if ((data[0] & 0x0F) != me->rxSequence)
+        {
+            me->rxInProgress = FALSE;
+            me->errorCount++;
+            break;
+        }
+        count = me->rxLength - me->rxReceived;
+        if (count > 7) { count = 7; }
+        if (count >= canMessage->length) { count = canMessage->length - 1; }
+        for (ubyte1 i = 0; i < count; i++) { me->rxBuffer[me->rxReceived + i] = data[1 + i]; }
+        me->rxReceived += count;
+        me->rxSequence = (me->rxSequence + 1) & 0x0F;
+        IO_RTC_StartTime(&me->timestamp_rx);
+        if (me->rxReceived >= me->rxLength)
+        {
+            me->rxInProgress = FALSE;
+            me->requestLength = me->rxLength;
+        }
+        break;
+
+    case ISOTP_FLOW_CONTROL:
+        if (me->txState != ISOTP_TX_WAIT_FC || canMessage->length < 3) { break; }
+        switch (data[0] & 0x0F)
+        {
+        case ISOTP_FC_CONTINUE:
+            me->blockSize = data[1];
+            me->blockRemaining = data[1];
+            me->separationUs = IsoTp_separationUs(data[2]);
+            me->txState = ISOTP_TX_CONSECUTIVE;
+            me->timestamp_tx = 0;  //First consecutive frame can go right away
+            break;
+        case ISOTP_FC_WAIT:
+            IO_RTC_StartTime(&me->timestamp_tx);
+            break;
+        default:  //Overflow / invalid
+            IsoTp_abortTx(me);
+            break;
+        }
+        break;
+    }
+}
+
+ubyte2 IsoTp_takeRequest(IsoTp* me, const ubyte1** data)
+{
+    ubyte2 length = me->requestLength;
+    me->requestLength = 0;
+    *data = me->rxBuffer;
+    return length;
+}
+
+bool IsoTp_send(IsoTp* me, ubyte2 length, IsoTpSource source, void* object)
+{
+    if (me->txState != ISOTP_TX_IDLE || length == 0 || length > ISOTP_MAX_LENGTH)
+    {
+        return FALSE;
+    }
+
+    me->source = source;
+    me->sourceObject = object;
+    me->txLength = length;
+    me->txOffset = 0;
+    me->txChunkLength = 0;
+    me->txSequence = 1;
+    me->txState = ISOTP_TX_FIRST;
+    return TRUE;
+}
+
+bool IsoTp_isBusy(IsoTp* me)
+{
+    return me->txState != ISOTP_TX_IDLE;
+}
+
+//Pulls data for the next frame from the source.  TRUE once "needed" bytes are in txChunk.
+static bool IsoTp_fillChunk(IsoTp* me, ubyte1 needed)
+{
+    while (me->txChunkLength < needed)
+    {
+        ubyte2 got = me->source(me->sourceObject, me->txOffset + me->txChunkLength
+                                , &me->txChunk[me->txChunkLength], needed - me->txChunkLength);
+        if (got == 0)
+        {
+            return FALSE;
+        }
+        me->txChunkLength += (ubyte1)got;
+    }
+    return TRUE;
+}
+
+bool IsoTp_nextFrame(IsoTp* me, ubyte1* data, ubyte1* length)
+{
+    ubyte2 remaining = me->txLength - me->txOffset;
+    ubyte1 needed;
+
+    //Receive side: the sender is waiting on our flow control
+    if (me->pendingFlowControl != ISOTP_FC_NONE)
+    {
+        data[0] = (ISOTP_FLOW_CONTROL << 4) | me->pendingFlowControl;
+        data[1] = 0;  //Block size: no limit
+        data[2] = 0;  //STmin: no gap
+        *length = 3;
+        me->pendingFlowControl = ISOTP_FC_NONE;
+        return TRUE;
+    }
+    if (me->rxInProgress == TRUE && IO_RTC_GetTimeUS(me->timestamp_rx) > ISOTP_TIMEOUT_US)
+    {
+        me->rxInProgress = FALSE;
+        me->errorCount++;
+    }
+
+    switch (me->txState)
+    {
+    case ISOTP_TX_FIRST:
+        if (me->txLength <= 7)
+        {
+            if (IsoTp_fillChunk(me, (ubyte1)me->txLength) == FALSE) { return FALSE; }
+            data[0] = (ISOTP_SINGLE << 4) | (ubyte1)me->txLength;
+            for (ubyte1 i = 0; i < me->txLength; i++) { data[1 + i] = me->txChunk[i]; }
+            *length = 1 + (ubyte1)me->txLength;
+            me->txState = ISOTP_TX_IDLE;
+            return TRUE;
+        }
+        if (IsoTp_fillChunk(me, 6) == FALSE) { return FALSE; }
+        data[0] = (ISOTP_FIRST << 4) | (ubyte1)(me->txLength >> 8);
+        data[1] = (ubyte1)me->txLength;
+        for (ubyte1 i = 0; i < 6; i++) { data[2 + i] = me->txChunk[i]; }
+        *length = 8;
+        me->txOffset = 6;
+        me->txChunkLength = 0;
+        me->txState = ISOTP_TX_WAIT_FC;
+        IO_RTC_StartTime(&me->timestamp_tx);
+        return TRUE;
+
+    case ISOTP_TX_WAIT_FC:
+        if (IO_RTC_GetTimeUS(me->timestamp_tx) > ISOTP_TIMEOUT_US)
+        {
+            IsoTp_abortTx(me);
+        }
+        return FALSE;
+
+    case ISOTP_TX_CONSECUTIVE:
+        if (me->separationUs > 0 && me->timestamp_tx != 0 && IO_RTC_GetTimeUS(me->timestamp_tx) < me->separationUs)
+        {
+            return FALSE;
+        }
+        needed = (remaining > 7) ? 7 : (ubyte1)remaining;
+        if (IsoTp_fillChunk(me, needed) == FALSE) { return FALSE; }
+        data[0] = (ISOTP_CONSECUTIVE << 4) | me->txSequence;
+        for (ubyte1 i = 0; i < needed; i++) { data[1 + i] = me->txChunk[i]; }
+        *length = 1 + needed;
+        me->txSequence = (me->txSequence + 1) & 0x0F;
+        me->txOffset += needed;
+        me->txChunkLength = 0;
+        IO_RTC_StartTime(&me->timestamp_tx);
+
+        if (me->txOffset >= me->txLength)
+        {
+            me->txState = ISOTP_TX_IDLE;
+        }
+        else if (me->blockSize > 0 && --me->blockRemaining == 0)
+        {
+            me->txState = ISOTP_TX_WAIT_FC;
+        }
+        return TRUE;
+
+    default:
+        return FALSE;
+    }
+}
+
+ubyte2 IsoTp_getErrorCount(IsoTp* me)
+{
+    return me->errorCount;
+}
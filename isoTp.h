@@ -0,0 +1,63 @@
+#ifndef _ISOTP_H
+#define _ISOTP_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+/*****************************************************************************
+* ISO-TP (ISO 15765-2 style) transport
+******************************************************************************
+* Moves messages of up to 4095 bytes over 8-byte CAN frames, one request ID
+* and one response ID (normal addressing):
+*
+*   Single frame       0L dd dd dd dd dd dd dd      L = length (1-7)
+*   First frame        1L LL dd dd dd dd dd dd      LLL = length (8-4095)
+*   Consecutive frame  2N dd dd dd dd dd dd dd      N = sequence, 1..F,0..
+*   Flow control       3S BS ST                     S = 0 go / 1 wait / 2 overflow
+*
+* Transmit: IsoTp_send only records where the data comes from.  Frames are
+* made by IsoTp_nextFrame, which canOutput_sendIsoTpFrames calls a few times
+* per cycle, so a long transfer is spread over many cycles and never holds up
+* the control loop.  Data is pulled from an IsoTpSource a frame at a time, so
+* nothing has to be copied into one big buffer first.  The receiver's flow
+* control (block size, STmin) is obeyed.
+*
+* Receive: incoming requests of up to ISOTP_RX_BUFFER bytes are reassembled
+* (we answer first frames with "go, no block limit, no gap") and handed out
+* by IsoTp_takeRequest.
+*
+* Timeouts: a transfer is dropped if the other side goes quiet for
+* ISOTP_TIMEOUT_US (no flow control, or no next consecutive frame).
+****************************************************************************/
+
+#define ISOTP_MAX_LENGTH 4095
+#define ISOTP_RX_BUFFER 256
+#define ISOTP_FRAMES_PER_CYCLE 8
+#define ISOTP_TIMEOUT_US 1000000
+
+//Copies up to "length" bytes starting at "offset" of the message into data.
+//Returns how many it copied - 0 = not ready yet (asked again next cycle).
+typedef ubyte2 (*IsoTpSource)(void* object, ubyte2 offset, ubyte1* data, ubyte2 length);
+
+typedef struct _IsoTp IsoTp;
+
+IsoTp* IsoTp_new(ubyte2 rxId, ubyte2 txId);
+ubyte2 IsoTp_getRxId(IsoTp* me);
+ubyte2 IsoTp_getTxId(IsoTp* me);
+
+void IsoTp_parseCanMessage(IsoTp* me, IO_CAN_DATA_FRAME* canMessage);  //rxId
+
+//Complete request received: returns its length (0 = none) and points data at it.
+//The data is good until the next call to IsoTp_parseCanMessage.
+ubyte2 IsoTp_takeRequest(IsoTp* me, const ubyte1** data);
+
+//FALSE if a transfer is already running or the message is too long
+bool IsoTp_send(IsoTp* me, ubyte2 length, IsoTpSource source, void* object);
+bool IsoTp_isBusy(IsoTp* me);
+
+//Next frame to put on the bus, if any is due now
+bool IsoTp_nextFrame(IsoTp* me, ubyte1* data, ubyte1* length);
+
+ubyte2 IsoTp_getErrorCount(IsoTp* me);  //Timeouts, overflows, bad sequence numbers
+
+#endif //  _ISOTP_H
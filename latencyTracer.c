@@ -0,0 +1,111 @@
+#include "IO_Driver.h"
+#include "IO_RTC.h"
+
+#include "latencyTracer.h"
+
+struct _LatencyTracer
+{
+    ubyte4 timestamp_cycleStart;  //Pedal sample time for this cycle
+    ubyte2 stageTime[LATENCY_STAGE_COUNT];
+
+    //Only one command is traced at a time - further changes are ignored until it is echoed or times out
+    bool tracing;
+    sbyte2 tracedTorqueDNm;
+    ubyte4 timestamp_tracedSample;
+    sbyte2 lastSentTorqueDNm;
+
+    ubyte1 buckets[LATENCY_BUCKET_COUNT];  //Saturate at 255
+    ubyte2 updateCount;
+};
+
+static struct _LatencyTracer latencyTracerInstance;
+
+LatencyTracer* LatencyTracer_new(void)
+{
+    LatencyTracer* me = &latencyTracerInstance;
+
+    me->tracing = FALSE;
+    me->lastSentTorqueDNm = 0;
+    me->updateCount = 0;
+    for (ubyte1 i = 0; i < LATENCY_BUCKET_COUNT; i++) { me->buckets[i] = 0; }
+    for (ubyte1 i = 0; i < LATENCY_STAGE_COUNT; i++) { me->stageTime[i] = 0; }
+
+    return me;
+}
+
+static void LatencyTracer_addSample(LatencyTracer* me, ubyte4 latency_us)
+{
+    ubyte1 bucket = (latency_us >= LATENCY_BUCKET_US * (LATENCY_BUCKET_COUNT - 1))
+                  ? LATENCY_BUCKET_COUNT - 1
+                  : (ubyte1)(latency_us / LATENCY_BUCKET_US);
+
+    if (me->buckets[bucket] < 0xFF)
+    {
+        me->buckets[bucket]++;
+    }
+    me->updateCount++;
+}
+
+void LatencyTracer_startCycle(LatencyTracer* me)
+{
+    IO_RTC_StartTime(&me->timestamp_cycleStart);
+    me->stageTime[LATENCY_STAGE_CAN_SEND] = 0;  //Stays 0 unless 0xC0 goes out this cycle
+}
+
+void LatencyTracer_mark(LatencyTracer* me, LatencyStage stage)
+{
+    ubyte4 elapsed = IO_RTC_GetTimeUS(me->timestamp_cycleStart);
+    me->stageTime[stage] = (elapsed > 0xFFFF) ? 0xFFFF : (ubyte2)elapsed;
+}
+
+//Start tracing a torque command if it's different from the last one sent
+void LatencyTracer_commandSent(LatencyTracer* me, sbyte2 torqueCommandDNm)
+{
+    LatencyTracer_mark(me, LATENCY_STAGE_CAN_SEND);
+
+    if (me->tracing == FALSE && torqueCommandDNm != me->lastSentTorqueDNm)
+    {
+        me->tracing = TRUE;
+        me->tracedTorqueDNm = torqueCommandDNm;
+        me->timestamp_tracedSample = me->timestamp_cycleStart;
+    }
+    me->lastSentTorqueDNm = torqueCommandDNm;
+}
+
+//0xAC reports whole Nm, so compare against the traced command in Nm
+void LatencyTracer_checkEcho(LatencyTracer* me, sbyte2 commandedTorqueNm)
+{
+    ubyte4 elapsed;
+
+    if (me->tracing == FALSE)
+    {
+        return;
+    }
+
+    elapsed = IO_RTC_GetTimeUS(me->timestamp_tracedSample);
+    if (commandedTorqueNm == me->tracedTorqueDNm / 10)
+    {
+        LatencyTracer_addSample(me, elapsed);
+        me->tracing = FALSE;
+    }
+    else if (elapsed >= LATENCY_ECHO_TIMEOUT_US)
+    {
+        LatencyTracer_addSample(me, elapsed);  //Lands in the last bucket
+        me->tracing = FALSE;
+    }
+}
+
+ubyte2 LatencyTracer_getStageTime(LatencyTracer* me, LatencyStage stage)
+{
+    return me->stageTime[stage];
+}
+
+ubyte1 LatencyTracer_getBucketCount(LatencyTracer* me, ubyte1 bucket)
+{
+    return me->buckets[bucket];
+}
+
+ubyte2 LatencyTracer_getUpdateCount(LatencyTracer* me)
+{
+    return me->updateCount;
+}
@@ -0,0 +1,50 @@
+#ifndef _LATENCYTRACER_H
+#define _LATENCYTRACER_H
+
+#include "IO_Driver.h"
+
+/*****************************************************************************
+* Latency Tracer
+******************************************************************************
+* Measures pedal-to-torque latency:
+*   - Stage times: how long after the start of the cycle (the pedal sample)
+*     each processing stage finished, every cycle.
+*   - Echo latency: when a changed torque command leaves the VCU, how long
+*     until the MCM reports that torque back as "commanded torque" (0xAC).
+*     0xAC is only read once per main loop, so this has loop-period resolution.
+*
+* Usage (main loop):
+*   LatencyTracer_startCycle    - right before sensors_updateSensors
+*   LatencyTracer_checkEcho     - right after CanManager_read
+*   LatencyTracer_mark          - after each stage
+*   LatencyTracer_commandSent   - when 0xC0 actually went out
+****************************************************************************/
+
+typedef enum
+{
+      LATENCY_STAGE_TPS          //TorqueEncoder_update done
+    , LATENCY_STAGE_COMMANDS     //MCM_calculateCommands done
+    , LATENCY_STAGE_SAFETY       //SafetyChecker_reduceTorque done
+    , LATENCY_STAGE_CAN_SEND     //0xC0 handed to the CAN controller (0 = not sent this cycle)
+    , LATENCY_STAGE_COUNT
+} LatencyStage;
+
+//Echo histogram: LATENCY_BUCKET_COUNT - 1 buckets of LATENCY_BUCKET_US each, last bucket = longer/timed out
+#define LATENCY_BUCKET_COUNT 8
+#define LATENCY_BUCKET_US 10000
+#define LATENCY_ECHO_TIMEOUT_US 500000
+
+typedef struct _LatencyTracer LatencyTracer;
+
+LatencyTracer* LatencyTracer_new(void);
+
+void LatencyTracer_startCycle(LatencyTracer* me);
+void LatencyTracer_mark(LatencyTracer* me, LatencyStage stage);
+void LatencyTracer_commandSent(LatencyTracer* me, sbyte2 torqueCommandDNm);
+void LatencyTracer_checkEcho(LatencyTracer* me, sbyte2 commandedTorqueNm);
+
+ubyte2 LatencyTracer_getStageTime(LatencyTracer* me, LatencyStage stage);  //us after the pedal sample
+ubyte1 LatencyTracer_getBucketCount(LatencyTracer* me, ubyte1 bucket);
+ubyte2 LatencyTracer_getUpdateCount(LatencyTracer* me);  //Incremented on each new echo measurement
+
+#endif //  _LATENCYTRACER_H
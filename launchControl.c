@@ -0,0 +1,191 @@
+#include "IO_Driver.h"
+#include "IO_RTC.h"
+
+#include "launchControl.h"
+#include "motorController.h"
+#include "torqueEncoder.h"
+#include "brakePressureSensor.h"
+#include "wheelSpeeds.h"
+
+//Above this the car is "moving" - can't arm, and no longer armed
+#define LAUNCH_STOPPED_KPH 2
+//Launch is over - normal driving (and the TCS knob) from here on
+#define LAUNCH_EXIT_KPH 60
+//Slip is meaningless at walking pace, so divide by at least this much ground speed
+#define LAUNCH_MIN_SLIP_SPEED_KPH 5
+//Same threshold the brake plausibility check uses
+#define LAUNCH_BRAKE_ON 0.05
+
+struct _LaunchControl
+{
+    ubyte1 maxTorquePercent;
+    float4 targetSlipPercent;
+    float4 gainPercentPerSlipPercent;
+    ubyte4 activeUs;
+
+    LaunchState state;
+    bool armRequested;     //From the dash (0x5FC), used up by the next update
+    bool cancelRequested;
+    sbyte2 launchTorqueDNm;  //maxTorquePercent of the MCM limit, taken when armed
+    ubyte4 timestamp_launchStart;
+
+    float4 slipPercent;
+    float4 groundKPH;
+    sbyte2 torqueLimitDNm;
+    ubyte2 updateCount;
+};
+
+static struct _LaunchControl launchControlInstance;
+
+LaunchControl* LaunchControl_new(ubyte1 maxTorquePercent, ubyte1 targetSlipPercent, ubyte1 gainPercentPerSlipPercent, ubyte2 activeMs)
+{
+    LaunchControl* me = &launchControlInstance;
+
+    me->maxTorquePercent = (maxTorquePercent > 100) ? 100 : maxTorquePercent;
+    me->targetSlipPercent = targetSlipPercent;
+    me->gainPercentPerSlipPercent = gainPercentPerSlipPercent;
+    me->activeUs = (ubyte4)activeMs * 1000;
+
+    me->state = LAUNCH_OFF;
+    me->armRequested = FALSE;
+    me->cancelRequested = FALSE;
+    me->launchTorqueDNm = 0;
+    me->timestamp_launchStart = 0;
+
+    me->slipPercent = 0;
+    me->groundKPH = 0;
+    me->torqueLimitDNm = 0;
+    me->updateCount = 0;
+
+    return me;
+}
+
+static void LaunchControl_setState(LaunchControl* me, LaunchState state)
+{
+    me->state = state;
+    me->updateCount++;
+}
+
+//0x5FC byte 0: 1 = arm, 0 = cancel (armed only - a running launch isn't cut short)
+void LaunchControl_parseCanMessage(LaunchControl* me, IO_CAN_DATA_FRAME* canMessage)
+{
+    if (canMessage->id != 0x5FC || canMessage->length < 1)
+    {
+        return;
+    }
+
+    switch (canMessage->data[0])
+    {
+    case 0:
+        me->cancelRequested = TRUE;
+        break;
+
+    case 1:
+        me->armRequested = TRUE;
+        break;
+    }
+}
+
+void LaunchControl_update(LaunchControl* me, MotorController* mcm, TorqueEncoder* tps, BrakePressureSensor* bps, WheelSpeeds* wss)
+{
+    bool armRequested = me->armRequested;
+    bool cancelRequested = me->cancelRequested;
+    bool brakeOn = (bps->percent > LAUNCH_BRAKE_ON);
+    float4 rearKPH = WheelSpeeds_getFastestRear(wss) * 3.6;
+    sbyte4 limit;
+
+    //The fused ground speed also trusts the motor speed, which is the rear axle -
+    //exactly what's slipping here.  Passing no motor speed leaves the front average.
+    me->groundKPH = WheelSpeeds_getFusedGroundSpeedKPH(wss, 0);
+    me->slipPercent = (rearKPH - me->groundKPH) * 100
+        / ((me->groundKPH > LAUNCH_MIN_SLIP_SPEED_KPH) ? me->groundKPH : LAUNCH_MIN_SLIP_SPEED_KPH);
+
+    me->armRequested = FALSE;
+    me->cancelRequested = FALSE;
+
+    switch (me->state)
+    {
+    case LAUNCH_OFF:
+        if (armRequested == TRUE
+            && MCM_getStartupStage(mcm) == MCM_STAGE_DRIVE
+            && me->groundKPH < LAUNCH_STOPPED_KPH && rearKPH < LAUNCH_STOPPED_KPH
+            && brakeOn == TRUE)
+        {
+            me->launchTorqueDNm = (sbyte2)((ubyte4)MCM_getTorqueMax(mcm) * me->maxTorquePercent / 100);
+            me->torqueLimitDNm = me->launchTorqueDNm;
+            LaunchControl_setState(me, LAUNCH_ARMED);
+        }
+        break;
+
+    case LAUNCH_ARMED:
+        if (cancelRequested == TRUE
+            || MCM_getStartupStage(mcm) != MCM_STAGE_DRIVE || me->groundKPH >= LAUNCH_STOPPED_KPH)
+        {
+            LaunchControl_setState(me, LAUNCH_OFF);
+        }
+        else if (brakeOn == FALSE)
+        {
+            IO_RTC_StartTime(&me->timestamp_launchStart);
+            LaunchControl_setState(me, LAUNCH_ACTIVE);
+        }
+        break;
+
+    case LAUNCH_ACTIVE:
+        if (MCM_getStartupStage(mcm) != MCM_STAGE_DRIVE || brakeOn == TRUE
+            || me->groundKPH >= LAUNCH_EXIT_KPH
+            || IO_RTC_GetTimeUS(me->timestamp_launchStart) >= me->activeUs)
+        {
+            me->torqueLimitDNm = me->launchTorqueDNm;
+            LaunchControl_setState(me, LAUNCH_OFF);
+            break;
+        }
+
+        //P control on slip over the target.  No integral - the cap snaps back
+        //as soon as the tires hook up, and the launch only lasts a few seconds.
+        limit = me->launchTorqueDNm;
+        if (me->slipPercent > me->targetSlipPercent)
+        {
+            limit -= (sbyte4)(me->launchTorqueDNm * (me->slipPercent - me->targetSlipPercent) * me->gainPercentPerSlipPercent / 100);
+        }
+        me->torqueLimitDNm = (limit < 0) ? 0 : (sbyte2)limit;
+        break;
+
+    default:
+        LaunchControl_setState(me, LAUNCH_OFF);
+        break;
+    }
+}
+
+void LaunchControl_limitTorque(LaunchControl* me, MotorController* mcm)
+{
+    if (me->state == LAUNCH_ACTIVE && MCM_commands_getTorque(mcm) > me->torqueLimitDNm)
+    {
+        MCM_commands_setTorqueDNm(mcm, me->torqueLimitDNm);
+    }
+}
+
+LaunchState LaunchControl_getState(LaunchControl* me)
+{
+    return me->state;
+}
+
+sbyte2 LaunchControl_getSlipPercentX10(LaunchControl* me)
+{
+    float4 slip = me->slipPercent * 10;
+    return (slip > 32767) ? 32767 : (slip < -32768) ? -32768 : (sbyte2)slip;
+}
+
+sbyte2 LaunchControl_getTorqueLimitDNm(LaunchControl* me)
+{
+    return me->torqueLimitDNm;
+}
+
+ubyte1 LaunchControl_getGroundSpeedKPH(LaunchControl* me)
+{
+    return (me->groundKPH > 255) ? 255 : (ubyte1)me->groundKPH;
+}
+
+ubyte2 LaunchControl_getUpdateCount(LaunchControl* me)
+{
+    return me->updateCount;
+}
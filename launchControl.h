@@ -0,0 +1,61 @@
+#ifndef _LAUNCHCONTROL_H
+#define _LAUNCHCONTROL_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+#include "motorController.h"
+#include "torqueEncoder.h"
+#include "brakePressureSensor.h"
+#include "wheelSpeeds.h"
+
+/*****************************************************************************
+* Launch Control
+******************************************************************************
+* Arming: the dash sends 0x5FC byte 0 = 1 while the car is in drive,
+* stopped, with the brake on (the TCS switches are no longer on the car).
+* 0x5FC byte 0 = 0 cancels an armed launch.  Requests made
+* when those conditions aren't met are dropped, not remembered.  Moving or
+* leaving drive disarms it.  There's no free dash light, so the state is
+* shown by the dash from 0x524 byte 0.
+*
+* Launch: releasing the brake starts the launch.  For the next few seconds
+* torque is capped, and the cap is pulled down in proportion to how far rear
+* slip is over the target:
+*
+*   slip      = (fastest rear - ground speed) / ground speed
+*   torque    = launch torque x (1 - gain% x (slip - target slip) / 100)
+*
+* Launch torque is a % of the MCM's torque limit (MCM_getTorqueMax), taken
+* when the launch is armed, so the cap can never ask for more than the MCM
+* is set up for.
+*
+* Ground speed is the front average - see LaunchControl_update.  The launch
+* ends on timeout, on the brake, or at the exit speed.  The driver's pedal
+* still applies underneath the cap.
+****************************************************************************/
+
+typedef enum
+{
+      LAUNCH_OFF
+    , LAUNCH_ARMED
+    , LAUNCH_ACTIVE
+} LaunchState;
+
+typedef struct _LaunchControl LaunchControl;
+
+//maxTorquePercent: % of MCM_getTorqueMax (at most 100), gainPercentPerSlipPercent: % of the launch torque removed per % of slip over the target
+LaunchControl* LaunchControl_new(ubyte1 maxTorquePercent, ubyte1 targetSlipPercent, ubyte1 gainPercentPerSlipPercent, ubyte2 activeMs);
+
+void LaunchControl_parseCanMessage(LaunchControl* me, IO_CAN_DATA_FRAME* canMessage);  //0x5FC
+//Call once per cycle after WheelSpeeds_update
+void LaunchControl_update(LaunchControl* me, MotorController* mcm, TorqueEncoder* tps, BrakePressureSensor* bps, WheelSpeeds* wss);
+//Call after SafetyChecker_reduceTorque - only ever lowers the torque command
+void LaunchControl_limitTorque(LaunchControl* me, MotorController* mcm);
+
+LaunchState LaunchControl_getState(LaunchControl* me);
+sbyte2 LaunchControl_getSlipPercentX10(LaunchControl* me);
+sbyte2 LaunchControl_getTorqueLimitDNm(LaunchControl* me);
+ubyte1 LaunchControl_getGroundSpeedKPH(LaunchControl* me);
+ubyte2 LaunchControl_getUpdateCount(LaunchControl* me);
+
+#endif //  _LAUNCHCONTROL_H
@@ -46,6 +46,19 @@
 #include "sensorCalculations.h"
 #include "serial.h"
 #include "cooling.h"
+#include "chassisSensors.h"
+#include "stackMonitor.h"
+#include "latencyTracer.h"
+#include "torqueMap.h"
+#include "thermalDerating.h"
+#include "powerLimiter.h"
+#include "energyEstimator.h"
+#include "ecoMode.h"
+#include "launchControl.h"
+#include "freezeFrame.h"
+#include "faultLog.h"
+#include "isoTp.h"
+#include "diagnostics.h"
 
 //Application Database, needed for TTC-Downloader
 APDB appl_db =
@@ -113,6 +126,9 @@ void main(void)
     /*******************************************/
     /*        Low Level Initializations        */
     /*******************************************/
+    //Paint the stack before anything else runs (especially interrupts)
+    StackMonitor* stackMon = StackMonitor_new(512);
+
     IO_Driver_Init(NULL); //Handles basic startup for all VCU subsystems
 
     //Initialize serial first so we can use it to debug init of other subsystems
@@ -123,6 +139,7 @@ void main(void)
 
     //Read initial values from EEPROM
     //EEPROMManager* EEPROMManager_new();
+    FaultLog* faultLog = FaultLog_new();  //Reads the fault history back (waits for EEPROM)
 
 
     /*******************************************/
@@ -179,6 +196,8 @@ void main(void)
     //----------------------------------------------------------------------------
     // Object representations of external devices
     // Most default values for things should be specified here
+    // Note: Each _new() hands back a statically allocated object (no heap), so
+    // each of these can only be created once.  See "make rammap" for RAM usage.
     //----------------------------------------------------------------------------    
     ReadyToDriveSound* rtds = RTDS_new();
     //BatteryManagementSystem* bms = BMS_new();
@@ -186,9 +205,30 @@ void main(void)
     TorqueEncoder* tps = TorqueEncoder_new(bench);
     BrakePressureSensor* bps = BrakePressureSensor_new();
     WheelSpeeds* wss = WheelSpeeds_new(18, 18, 16, 16);
-    SafetyChecker* sc = SafetyChecker_new(serialMan, 320, 32);  //Must match amp limits 
+    SafetyChecker* sc = SafetyChecker_new(serialMan, 33000, 320, 32);  //Main loop period (us), amp limits (must match BMS) 
     BatteryManagementSystem* bms = BMS_new(serialMan, 0x620);
     CoolingSystem* cs = CoolingSystem_new(serialMan);
+    ChassisSensors* chassis = ChassisSensors_new(3);  //Dashboard gets every 3rd sample (~10 Hz)
+    LatencyTracer* latency = LatencyTracer_new();
+    TorqueMap* torqueMap = TorqueMap_new();  //Default maps - TorqueMap_load to replace one
+    ThermalDerating* thermal = ThermalDerating_new();
+    PowerLimiter* powerLimiter = PowerLimiter_new(33000, 76000);  //Main loop period (us), target W (rules limit is 80 kW)
+    EnergyEstimator* energy = EnergyEstimator_new(bms, 6500);  //Nominal pack energy (Wh)
+    EcoMode* eco = EcoMode_new(22, 300, 80, 300);  //Endurance laps, reserve Wh, lap time (s) until the first lap marker, peak/average power %
+    FreezeFrame* freeze = FreezeFrame_new();
+    LaunchControl* launch = LaunchControl_new(100, 10, 4, 3000);  //Launch torque (% of MCM limit), target slip %, % of launch torque off per % slip over target, launch length (ms)
+    IsoTp* isoTp = IsoTp_new(0x5F0, 0x5F8);  //Request ID, response ID (CAN1)
+    Diagnostics* diagnostics = Diagnostics_new(isoTp, freeze, faultLog, sc, stackMon, torqueMap, mcm0);
+
+    //Route incoming CAN messages to the objects above (add a line per extra motor controller)
+    CanManager_addMotorController(canMan, CAN0_HIPRI, mcm0);
+    CanManager_addBMS(canMan, CAN0_HIPRI, bms);
+    CanManager_addSafetyChecker(canMan, CAN0_HIPRI, sc);
+    CanManager_addEnergyEstimator(canMan, CAN0_HIPRI, energy);
+    CanManager_addFreezeFrame(canMan, CAN0_HIPRI, freeze);
+    CanManager_addLaunchControl(canMan, CAN0_HIPRI, launch);
+    CanManager_addIsoTp(canMan, CAN1_LOPRI, isoTp);
+    CanManager_startReceiving(canMan);  //Hardware filters only let in what's registered above
 
     //----------------------------------------------------------------------------
     // TODO: Additional Initial Power-up functions
@@ -224,11 +264,19 @@ void main(void)
         // Handle data input streams
         //----------------------------------------------------------------------------
         //Get readings from our sensors and other local devices (buttons, 12v battery, etc)
+        LatencyTracer_startCycle(latency);
         sensors_updateSensors();
+        ChassisSensors_update(chassis);
 
         //Pull messages from CAN FIFO and update our object representations.
-        //Also echoes can0 messages to can1 for DAQ.
-        CanManager_read(canMan, CAN0_HIPRI, mcm0, bms, sc);
+        //Also echoes can0 messages to can1 for DAQ (only the ones we accept - see CanManager_startReceiving).
+        CanManager_read(canMan, CAN0_HIPRI);
+        CanManager_read(canMan, CAN1_LOPRI);  //Diagnostic requests
+        LatencyTracer_checkEcho(latency, MCM_getCommandedTorque(mcm0));
+        ThermalDerating_update(thermal, mcm0, bms);
+        EcoMode_update(eco, energy);
+        PowerLimiter_setCapW(powerLimiter, EcoMode_getPowerCapW(eco));
+        PowerLimiter_update(powerLimiter, mcm0, bms);
         /*switch (CanManager_getReadStatus(canMan, CAN0_HIPRI))
         {
             case IO_E_OK: SerialManager_send(serialMan, "IO_E_OK: everything fine\n"); break;
@@ -271,12 +319,15 @@ void main(void)
         {
             if (IO_RTC_GetTimeUS(timestamp_EcoButton) > 10000 && IO_RTC_GetTimeUS(timestamp_EcoButton) < 1000000)
             {
-                SerialManager_send(serialMan, "Eco mode requested\n");
+                EcoMode_toggle(eco);
+                Light_set(Light_dashEco, EcoMode_isOn(eco) ? 1 : 0);
+                SerialManager_send(serialMan, EcoMode_isOn(eco) ? "Eco mode on\n" : "Eco mode off\n");
             }
             timestamp_EcoButton = 0;
         }
 
         TorqueEncoder_update(tps);
+        LatencyTracer_mark(latency, LATENCY_STAGE_TPS);
         //Every cycle: if the calibration was started and hasn't finished, check the values again
         TorqueEncoder_calibrationCycle(tps, &calibrationErrors); //Todo: deal with calibration errors
         BrakePressureSensor_update(bps, bench);
@@ -294,6 +345,7 @@ void main(void)
         //TractionControl_update(tps, mcm0, wss, daq);
 
         WheelSpeeds_update(wss);
+        LaunchControl_update(launch, mcm0, tps, bps, wss);
         //DataAquisition_update(); //includes accelerometer
         //TireModel_update()
         //ControlLaw_update();
@@ -311,14 +363,19 @@ void main(void)
         //motorController_setCommands(rtds);
         //DOES NOT set inverter command or rtds flag
         MCM_readTCSSettings(mcm0, &Sensor_TCSSwitchUp, &Sensor_TCSSwitchDown, &Sensor_TCSKnob);
-        MCM_calculateCommands(mcm0, tps, bps);
+        MCM_calculateCommands(mcm0, tps, bps, torqueMap);
+        LatencyTracer_mark(latency, LATENCY_STAGE_COMMANDS);
 
-        SafetyChecker_update(sc, mcm0, bms, tps, bps, &Sensor_HVILTerminationSense, &Sensor_LVBattery);
+        SafetyChecker_update(sc, mcm0, bms, tps, bps, &Sensor_HVILTerminationSense, &Sensor_LVBattery, powerLimiter);
+        FaultLog_update(faultLog, sc, mcm0, bms);
 
         /*******************************************/
         /*  Output Adjustments by Safety Checker   */
         /*******************************************/
-        SafetyChecker_reduceTorque(sc, mcm0, bms);
+        SafetyChecker_reduceTorque(sc, mcm0, bms, thermal, powerLimiter, wss);
+        LaunchControl_limitTorque(launch, mcm0);
+        FreezeFrame_record(freeze, tps, bps, mcm0, bms, sc);
+        LatencyTracer_mark(latency, LATENCY_STAGE_SAFETY);
 
         /*******************************************/
         /*              Enact Outputs              */
@@ -329,13 +386,32 @@ void main(void)
         //Handle motor controller startup procedures
         MCM_relayControl(mcm0, &Sensor_HVILTerminationSense);
         MCM_inverterControl(mcm0, tps, bps, rtds);
-        //CanManager_sendMCMCommandMessage(mcm0, canMan, FALSE);
+
+        //Commands are final - send them to the MCM now, ahead of all the debug traffic
+        if (canOutput_sendMCUControl(canMan, mcm0, FALSE) == TRUE)
+        {
+            LatencyTracer_commandSent(latency, MCM_commands_getTorque(mcm0));
+        }
 
         //Drop the sensor readings into CAN (just raw data, not calculated stuff)
-        //canOutput_sendMCUControl(mcm0, FALSE);
 
         //Send debug data
         canOutput_sendDebugMessage(canMan, tps, bps, mcm0, wss, sc);
+        canOutput_sendChassisMessages(canMan, chassis);
+        StackMonitor_update(stackMon);
+        canOutput_sendStackMessage(canMan, stackMon);
+        canOutput_sendLatencyMessages(canMan, latency);
+        canOutput_sendStartupMessage(canMan, mcm0);
+        canOutput_sendThermalMessage(canMan, thermal, mcm0, bms);
+        canOutput_sendPowerMessage(canMan, powerLimiter);
+        canOutput_sendEnergyMessage(canMan, energy);
+        canOutput_sendEcoMessage(canMan, eco, powerLimiter);
+        canOutput_sendLaunchMessage(canMan, launch, mcm0);
+        canOutput_sendSafetyRuleTiming(canMan, sc);
+        canOutput_sendFreezeFrame(canMan, freeze);
+        canOutput_sendFaultLogMessage(canMan, faultLog);
+        Diagnostics_update(diagnostics);
+        canOutput_sendIsoTpFrames(canMan, CAN1_LOPRI, isoTp);
         //canOutput_sendSensorMessages();
         //canOutput_sendStatusMessages(mcm0);
        
@@ -1,4 +1,3 @@
-#include <stdlib.h>  //Needed for malloc
 #include "IO_Driver.h"
 #include "IO_DIO.h"     //TEMPORARY - until MCM relay control  / ADC stuff gets its own object
 #include "IO_RTC.h"
@@ -13,6 +12,7 @@
 #include "brakePressureSensor.h"
 #include "readyToDriveSound.h"
 #include "serial.h"
+#include "torqueMap.h"
 
 #include "canManager.h"
 
@@ -66,21 +66,31 @@ struct _MotorController {
     bool HVILOverride;
 
     ubyte1 startupStage;
+    ubyte4 timeStamp_HVILHigh;   //Startup timing reference - when the MCM_STAGE_LOCKOUT stage was entered
+    ubyte2 stageEnteredMs[MCM_STAGE_COUNT];  //ms after HVIL high that each stage was reached this startup, 0xFFFF = not reached
+    ubyte1 startupTransitionCount;
     Status lockoutStatus;
 	Status inverterStatus;
 	bool startRTDS;
 	/*ubyte4 vsmStatus0;      //0xAA Byte 0,1
     ubyte4 vsmStatus1;      //0xAA Byte 0,1
     ubyte4 vsmStatus2;      //0xAA Byte 0,1
-    ubyte4 vsmStatus3;      //0xAA Byte 0,1
+    ubyte4 vsmStatus3;      //0xAA Byte 0,1*/
     ubyte4 faultCodesPOST; //0xAB Byte 0-3
-    ubyte4 faultCodesRUN;  //0xAB Byte 4-7*/
+    ubyte4 faultCodesRUN;  //0xAB Byte 4-7
+    ubyte2 faultUpdateCount;
 
-    ubyte1 faultHistory[8];
+    ubyte1 faultHistory[8];  //Every 0xAB bit seen since power-up (persistent history: see faultLog.h)
 
 	sbyte2 motor_temp;
+	sbyte2 moduleTemp[3];       //Inverter power modules A/B/C (0xA0), C
+	sbyte2 gateDriverTemp;
+	ubyte2 moduleTempUpdateCount;  //Bumped when 0xA0 arrives
+	ubyte2 motorTempUpdateCount;   //Bumped when 0xA2 arrives
 	sbyte4 DC_Voltage;
 	sbyte4 DC_Current;
+	sbyte2 DC_Voltage_dV;  //Unrounded copies (0.1 V / 0.1 A) for power calculations
+	sbyte2 DC_Current_dA;
 
 	sbyte2 commandedTorque;
 	ubyte4 currentPower;
@@ -127,9 +137,20 @@ struct _MotorController {
     //};
 };
 
+//One per motor - see MCM_CONTROLLERS_MAX
+static struct _MotorController motorControllerInstances[MCM_CONTROLLERS_MAX];
+static ubyte1 motorControllerCount = 0;
+
 MotorController* MotorController_new(SerialManager* sm, ubyte2 canMessageBaseID, Direction initialDirection, sbyte2 torqueMaxInDNm, sbyte1 minRegenSpeedKPH, sbyte1 regenRampdownStartSpeed)
 {
-	MotorController* me = (MotorController*)malloc(sizeof(struct _MotorController));
+	MotorController* me;
+
+    if (motorControllerCount >= MCM_CONTROLLERS_MAX)
+    {
+        SerialManager_send(sm, "ERROR: Too many motor controllers - raise MCM_CONTROLLERS_MAX.\n");
+        return NULL;
+    }
+    me = &motorControllerInstances[motorControllerCount++];
     me->serialMan = sm;
 
 	me->canMessageBaseId = canMessageBaseID;
@@ -143,11 +164,13 @@ MotorController* MotorController_new(SerialManager* sm, ubyte2 canMessageBaseID,
     me->motorRPM = 0;
     me->DC_Voltage = 0;
     me->DC_Current = 0;
+    me->DC_Voltage_dV = 0;
+    me->DC_Current_dA = 0;
 
 	me->commands_direction = initialDirection;
 	me->commands_torqueLimit = me->torqueMaximumDNm = torqueMaxInDNm;
 
-	me->regen_mode = 0xFF;
+	me->regen_mode = 0xFF;  //Not read yet - MCM_readTCSSettings picks the mode from the knob
 	me->regen_torqueLimitDNm = 0;
 	me->regen_torqueAtZeroPedalDNm = 0;
     me->regen_percentBPSForMaxRegen = 1; //zero to one.. 1 = 100%
@@ -155,13 +178,31 @@ MotorController* MotorController_new(SerialManager* sm, ubyte2 canMessageBaseID,
     me->regen_minimumSpeedKPH = minRegenSpeedKPH;  //Assigned by main
     me->regen_SpeedRampStart = regenRampdownStartSpeed;  //Assigned by main
 
-    //me->faultHistory = { 0,0,0,0,0,0,0,0 };  //Todo: read from eeprom instead of defaulting to 0
+    me->faultCodesPOST = 0;
+    me->faultCodesRUN = 0;
+    me->faultUpdateCount = 0;
+    for (ubyte1 i = 0; i < 8; i++)
+    {
+        me->faultHistory[i] = 0;
+    }
 
-	me->startupStage = 0; //Off
+	me->startupStage = MCM_STAGE_OFF;
+    for (ubyte1 stage = 0; stage < MCM_STAGE_COUNT; stage++)
+    {
+        me->stageEnteredMs[stage] = 0xFFFF;
+    }
+    me->startupTransitionCount = 0;
     
     me->relayState = FALSE; //Low
 
     me->motor_temp = 99;
+    for (ubyte1 module = 0; module < 3; module++)
+    {
+        me->moduleTemp[module] = 99;
+    }
+    me->gateDriverTemp = 99;
+    me->moduleTempUpdateCount = 0;  //0 = the 99s above are placeholders, not readings
+    me->motorTempUpdateCount = 0;
 	/*
     me->setTorque = &setTorque;
     me->setInverter = &setInverter;
@@ -190,60 +231,67 @@ MotorController* MotorController_new(SerialManager* sm, ubyte2 canMessageBaseID,
 // 4    3DA  986
 // .    3DA  986
 
+//Knob readings must move this far past a mode's edges before the mode changes
+#define REGEN_KNOB_HYSTERESIS 0x20
+
+typedef struct _RegenMode
+{
+    ubyte2 knobMin;                   //Knob raw value range for this position (inclusive)
+    ubyte2 knobMax;
+    ubyte1 torqueLimitPercent;        //Regen torque at full regen, % of torqueMaximumDNm
+    ubyte1 zeroPedalPercentOfLimit;   //Regen with both pedals released, % of the regen limit above
+    float4 percentAPPSForCoasting;    //Accel pedal needed to exit regen (0-1)
+    float4 percentBPSForMaxRegen;     //Brake pedal needed for full regen (0-1)
+} RegenMode;
+
+//Indexed by regen_mode (also the TorqueMap mode)
+static const RegenMode regenModes[TORQUEMAP_MODE_COUNT] =
+{
+    //knobMin knobMax  limit%  zero%  coastAPPS  maxBPS
+    { 5001,   0xFFFF,  0,      0,     0,         0  },  //Position 0 = Regen off (pot clicked off, reads ~FFFF)
+    { 0,      0xA0,    50,     0,     0,         .3 },  //Position 1 = Coasting mode (Formula E mode)
+    { 0xA1,   0x22F,   50,     30,    .2,        .3 },  //Position 2 = light "engine braking" (Hybrid mode)
+    { 0x230,  0x382,   50,     100,   .1,        0  },  //Position 3 = One pedal driving (Tesla mode)
+    { 0x383,  5000,    0,      0,     0,         0  },  //Position 4 = User customizable
+};
+
+static void MCM_applyRegenMode(MotorController* me, ubyte1 mode)
+{
+    const RegenMode* settings = &regenModes[mode];
+
+    me->regen_mode = mode;
+    me->regen_torqueLimitDNm = (ubyte4)me->torqueMaximumDNm * settings->torqueLimitPercent / 100;
+    me->regen_torqueAtZeroPedalDNm = (ubyte4)me->regen_torqueLimitDNm * settings->zeroPedalPercentOfLimit / 100;
+    me->regen_percentAPPSForCoasting = settings->percentAPPSForCoasting;
+    me->regen_percentBPSForMaxRegen = settings->percentBPSForMaxRegen; //zero to one.. 1 = 100%
+}
+
+//Resolves the knob into a mode, staying in the current mode until the reading is
+//REGEN_KNOB_HYSTERESIS past its edges.  Regen settings are only recalculated when the mode changes.
 void MCM_readTCSSettings(MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSwitchDown, Sensor* TCSPot)
-{	
-	 
+{
+    ubyte2 knob = TCSPot->sensorValue;
+    ubyte1 mode;
 
-	//If the pot is clicked off (resistance goes to FFFF)
-	if (TCSPot->sensorValue > 5000)  //Position 0 = Regen Off
+    if (me->regen_mode < TORQUEMAP_MODE_COUNT)
     {
-		me->regen_mode = 0;  
+        const RegenMode* current = &regenModes[me->regen_mode];
+        if ((ubyte4)knob + REGEN_KNOB_HYSTERESIS >= current->knobMin
+            && knob <= (ubyte4)current->knobMax + REGEN_KNOB_HYSTERESIS)
+        {
+            return;
+        }
+    }
 
-		me->regen_torqueLimitDNm = 0;
-		me->regen_torqueAtZeroPedalDNm = 0;
-		me->regen_percentAPPSForCoasting = 0;
-		me->regen_percentBPSForMaxRegen = 0; //zero to one.. 1 = 100%
-	}
-	else if (TCSPot->sensorValue < 0xA1)  //Position 1 = Coasting mode (Formula E mode)
-	{
-		me->regen_mode = 1;
-		me->regen_torqueLimitDNm = me->torqueMaximumDNm * 0.5;
-		me->regen_torqueAtZeroPedalDNm = 0;
-		me->regen_percentAPPSForCoasting = 0;
-		me->regen_percentBPSForMaxRegen = .3; //zero to one.. 1 = 100%
-	}
-	else if (TCSPot->sensorValue < 0x230)  //Position 2 = light "engine braking" (Hybrid mode)
-	{
-		me->regen_mode = 2;
-		me->regen_torqueLimitDNm = me->torqueMaximumDNm * 0.5;
-		me->regen_torqueAtZeroPedalDNm = me->regen_torqueLimitDNm * 0.3;
-		me->regen_percentAPPSForCoasting = .2;
-		me->regen_percentBPSForMaxRegen = .3; //zero to one.. 1 = 100%
-	}
-	else if (TCSPot->sensorValue < 0x383)  //Position 3 = One pedal driving (Tesla mode)
-	{
-		me->regen_mode = 3;
-		me->regen_torqueLimitDNm = me->torqueMaximumDNm * 0.5;
-		me->regen_torqueAtZeroPedalDNm = me->regen_torqueLimitDNm;
-		me->regen_percentAPPSForCoasting = .1;
-		me->regen_percentBPSForMaxRegen = 0;
-	}
-	else if (TCSPot->sensorValue >= 0x383)  //Position 4 = User customizable
-	{
-		me->regen_mode = 4;
-		me->regen_torqueLimitDNm = 0;
-		me->regen_torqueAtZeroPedalDNm = 0;
-		me->regen_percentBPSForMaxRegen = 0; //zero to one.. 1 = 100%
-		me->regen_percentAPPSForCoasting = 0;
-	}
-	else  //This should never happen
-	{
-		me->regen_mode = 0xFFFF;  //Default: Regen off
-		me->regen_torqueLimitDNm = 0;
-		me->regen_torqueAtZeroPedalDNm = 0;
-		me->regen_percentBPSForMaxRegen = 0; //zero to one.. 1 = 100%
-		me->regen_percentAPPSForCoasting = 0;
-	}
+    //Ranges cover 0-FFFF, so one of these always matches
+    for (mode = 0; mode < TORQUEMAP_MODE_COUNT - 1; mode++)
+    {
+        if (knob >= regenModes[mode].knobMin && knob <= regenModes[mode].knobMax)
+        {
+            break;
+        }
+    }
+    MCM_applyRegenMode(me, mode);
 }
 
 /*****************************************************************************
@@ -267,7 +315,7 @@ void MCM_readTCSSettings(MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSw
 * > Enable inverter
 * > Play RTDS
 ****************************************************************************/
-void MCM_calculateCommands(MotorController* me, TorqueEncoder* tps, BrakePressureSensor* bps)
+void MCM_calculateCommands(MotorController* me, TorqueEncoder* tps, BrakePressureSensor* bps, TorqueMap* map)
 {
 	//----------------------------------------------------------------------------
 	// Control commands
@@ -283,7 +331,8 @@ void MCM_calculateCommands(MotorController* me, TorqueEncoder* tps, BrakePressur
 	sbyte2 bpsTorque = 0;
     // temporary change
     // if (me->torqueMaximumDNm > 50) me->torqueMaximumDNm = 50;
-	appsTorque = me->torqueMaximumDNm * getPercent(tps->percent, me->regen_percentAPPSForCoasting, 1, TRUE) - me->regen_torqueAtZeroPedalDNm * getPercent(tps->percent, me->regen_percentAPPSForCoasting, 0, TRUE);
+	//Accelerator side (including off-throttle regen) comes from the current mode's pedal x speed map
+	appsTorque = TorqueMap_getTorqueDNm(map, me->regen_mode, tps->percent, me->motorRPM, me->torqueMaximumDNm);
 	bpsTorque = 0 - (me->regen_torqueLimitDNm - me->regen_torqueAtZeroPedalDNm) * getPercent(bps->percent, 0, me->regen_percentBPSForMaxRegen, TRUE);
 	
 	torqueOutput = appsTorque + bpsTorque;
@@ -321,10 +370,7 @@ void MCM_relayControl(MotorController* me, Sensor* HVILTermSense)
                 //For now do nothing
             }
         }
-        MCM_setStartupStage(me, 0);
-        MCM_updateInverterStatus(me, UNKNOWN);
-        MCM_updateLockoutStatus(me, UNKNOWN);
-
+        //The startup table (MCM_inverterControl) drops back to MCM_STAGE_OFF from here
         me->previousHVILState = FALSE;
     }
     else  // HVILTermSense->sensorValue == TRUE || me->HVILOverride == TRUE
@@ -333,10 +379,6 @@ void MCM_relayControl(MotorController* me, Sensor* HVILTermSense)
         if (me->previousHVILState == FALSE)
         {
             SerialManager_send(me->serialMan, "Term sense went high\n");
-            if (MCM_getStartupStage(me) == 0)
-            {
-                MCM_setStartupStage(me, 1); //Reset the startup procedure because HV just went high and we are now turning on the MCM
-            }
         }
         me->previousHVILState = TRUE;
 
@@ -346,98 +388,206 @@ void MCM_relayControl(MotorController* me, Sensor* HVILTermSense)
     }
 }
 
-//See diagram at https://onedrive.live.com/redir?resid=F9BB8F0F8FDB5CF8!30410&authkey=!ABSF-uVH-VxQRAs&ithint=file%2chtml
-void MCM_inverterControl(MotorController* me, TorqueEncoder* tps, BrakePressureSensor* bps, ReadyToDriveSound* rtds)
+/*****************************************************************************
+* Startup (ready-to-drive) state machine
+******************************************************************************
+* Each cycle MCM_inverterControl walks startupTransitions[] in order and takes
+* the first row whose "from" stage matches (MCM_STAGE_ANY matches every stage
+* but the row's own "to") and whose guard passes.  At most one transition
+* happens per cycle.  After that, the current stage's "during" action runs
+* and the RTD light is set.
+*
+* Guards only read state; actions are where commands change.  To add a path,
+* add a row - don't put side effects in a guard.
+*
+*   any    --HVIL lost-------------------------------------------> OFF
+*   OFF    --HVIL high-------------------------------------------> LOCKOUT
+*   LOCKOUT --MCM reports lockout disabled-----------------------> WAIT_RTD
+*   WAIT_RTD --RTD button + brake + no throttle / cmd inverter on-> WAIT_INVERTER
+*   WAIT_INVERTER --MCM reports inverter enabled / start RTDS----> RTD_COMPLETE
+*   RTD_COMPLETE --always----------------------------------------> DRIVE
+*
+* Every transition is timestamped relative to HVIL high (stageEnteredMs) so
+* time-to-drive can be read off CAN (0x50E).
+****************************************************************************/
+#define MCM_STAGE_ANY 0xFF
+
+typedef struct _StartupInputs {
+    TorqueEncoder* tps;
+    BrakePressureSensor* bps;
+    ReadyToDriveSound* rtds;
+} StartupInputs;
+
+typedef bool (*StartupGuard)(MotorController* me, const StartupInputs* in);
+typedef void (*StartupAction)(MotorController* me, const StartupInputs* in);
+
+typedef struct _StartupTransition {
+    ubyte1 from;
+    ubyte1 to;
+    StartupGuard guard;
+    StartupAction action;     //NULL = nothing to do
+    const char* message;      //Sent to serial when the transition is taken, NULL = none
+} StartupTransition;
+
+typedef struct _StartupState {
+    StartupAction during;     //Runs every cycle spent in this stage, NULL = nothing
+    bool rtdLight;            //RTD light forced on (otherwise it follows the RTD button)
+} StartupState;
+
+//---------------------------------------------------------------------------
+// Guards
+//---------------------------------------------------------------------------
+//previousHVILState was updated by MCM_relayControl earlier this cycle
+static bool startup_hvilLost(MotorController* me, const StartupInputs* in)
 {
-    float4 RTDPercent = 0;
-    RTDPercent = (Sensor_RTDButton.sensorValue == TRUE ? 1 : 0);
-    
-	//----------------------------------------------------------------------------
-	// Determine inverter state
-	//----------------------------------------------------------------------------
-	//New Handshake NOTE: Switches connected to ground.. TRUE = high = off = disconnected = open circuit, FALSE = low = grounded = on = connected = closed circuit
-    switch (MCM_getStartupStage(me))
-    {
-    case 0: //MCM relay is off --> stay until lockout is enabled;
-        //It shouldn't be necessary to check mcm relayState or inverter status <> UNKNOWN
-        //but if we have trouble we can add that here.
+    return me->previousHVILState == FALSE;
+}
 
-    case 1: //MCM relay is on, lockout=enabled, inverter=disabled --> stay until lockout is disabled
-        //Actions to perform upon entering this state ------------------------------------------------
-        MCM_commands_setInverter(me, DISABLED);
-        //Light_set(Light_dashRTD, 0);
+static bool startup_hvilHigh(MotorController* me, const StartupInputs* in)
+{
+    return me->previousHVILState == TRUE;
+}
 
-        //How to transition to next state ------------------------------------------------
-        if (MCM_getLockoutStatus(me) == DISABLED)
-        {
-            SerialManager_send(me->serialMan, "MCM lockout has been disabled.\n");
-            MCM_setStartupStage(me, 2); //MCM_setStartupStage(me, MCM_getStartupStage(me) + 1);
-        }
-        break;
+static bool startup_lockoutDisabled(MotorController* me, const StartupInputs* in)
+{
+    return MCM_getLockoutStatus(me) == DISABLED;
+}
 
-    case 2: //MCM on, lockout=disabled, inverter=disabled --> stay until RTD button pressed
-        //Actions to perform upon entering this state ------------------------------------------------
-        //Nothing: wait for RTD button
-
-        //How to transition to next state ------------------------------------------------
-        if (Sensor_RTDButton.sensorValue == TRUE // Could just put RTDPercent
-            && tps->calibrated == TRUE
-            && bps->calibrated == TRUE
-            && tps->percent < .1
-            && bps->percent > .25
-            )
-        {
-            MCM_commands_setInverter(me, ENABLED);  //Change the inverter command to enable
-            SerialManager_send(me->serialMan, "Changed MCM inverter command to ENABLE.\n");
-            MCM_setStartupStage(me, 3); // MCM_setStartupStage(me, MCM_getStartupStage(me) + 1);
-            //RTDPercent = 1; //no RTD light at this stage, we dont know if inverter is really enabled yet. It will be checked on the next stage
-        }
-        break;
+//New Handshake NOTE: Switches connected to ground.. TRUE = high = off = disconnected = open circuit, FALSE = low = grounded = on = connected = closed circuit
+static bool startup_rtdRequested(MotorController* me, const StartupInputs* in)
+{
+    return Sensor_RTDButton.sensorValue == TRUE
+        && in->tps->calibrated == TRUE
+        && in->bps->calibrated == TRUE
+        && in->tps->percent < .1
+        && in->bps->percent > .25;
+}
+
+static bool startup_inverterEnabled(MotorController* me, const StartupInputs* in)
+{
+    return MCM_getInverterStatus(me) == ENABLED;
+}
+
+static bool startup_always(MotorController* me, const StartupInputs* in)
+{
+    return TRUE;
+}
+
+//---------------------------------------------------------------------------
+// Actions
+//---------------------------------------------------------------------------
+static void startup_holdOff(MotorController* me, const StartupInputs* in)
+{
+    //HV is down, so whatever the MCM last told us is stale
+    MCM_updateInverterStatus(me, UNKNOWN);
+    MCM_updateLockoutStatus(me, UNKNOWN);
+    MCM_commands_setInverter(me, DISABLED);
+}
+
+static void startup_inverterDisable(MotorController* me, const StartupInputs* in)
+{
+    MCM_commands_setInverter(me, DISABLED);
+}
+
+static void startup_inverterEnable(MotorController* me, const StartupInputs* in)
+{
+    MCM_commands_setInverter(me, ENABLED);
+}
+
+static void startup_playRTDS(MotorController* me, const StartupInputs* in)
+{
+    RTDS_setVolume(in->rtds, 0, 1500000); // value 0 at normal testing (and 1 for the real ones, and of course at the comp), you dont want an eardrum rupture everytime right?
+}
+
+//---------------------------------------------------------------------------
+// Tables
+//---------------------------------------------------------------------------
+//Checked top to bottom - HVIL loss must stay first so it wins over everything
+static const StartupTransition startupTransitions[] = {
+    { MCM_STAGE_ANY,           MCM_STAGE_OFF,           startup_hvilLost,        NULL,                   NULL },
+    { MCM_STAGE_OFF,           MCM_STAGE_LOCKOUT,       startup_hvilHigh,        NULL,                   NULL },
+    { MCM_STAGE_LOCKOUT,       MCM_STAGE_WAIT_RTD,      startup_lockoutDisabled, NULL,                   "MCM lockout has been disabled.\n" },
+    { MCM_STAGE_WAIT_RTD,      MCM_STAGE_WAIT_INVERTER, startup_rtdRequested,    startup_inverterEnable, "Changed MCM inverter command to ENABLE.\n" },
+    { MCM_STAGE_WAIT_INVERTER, MCM_STAGE_RTD_COMPLETE,  startup_inverterEnabled, startup_playRTDS,       "Inverter has been enabled.  Starting RTDS.  Car is ready to drive.\n" },
+    { MCM_STAGE_RTD_COMPLETE,  MCM_STAGE_DRIVE,         startup_always,          NULL,                   "RTD procedure complete.\n" },
+};
+#define STARTUP_TRANSITION_COUNT (sizeof(startupTransitions) / sizeof(startupTransitions[0]))
+
+//Indexed by MCMStartupStage
+static const StartupState startupStates[MCM_STAGE_COUNT] = {
+    { startup_holdOff,         FALSE },  //OFF: MCM relay is off (or HV just dropped)
+    { startup_inverterDisable, FALSE },  //LOCKOUT: relay on, waiting for MCM to release lockout
+    { NULL,                    FALSE },  //WAIT_RTD: lockout released, waiting for driver
+    { NULL,                    FALSE },  //WAIT_INVERTER: enable commanded, waiting for MCM to confirm
+    { NULL,                    TRUE  },  //RTD_COMPLETE: RTDS started
+    { NULL,                    TRUE  },  //DRIVE: car is drivable
+};
 
-    case 3: //inverted=disabled, rtd=pressed, waiting for inverter to be enabled
-        //Actions to perform upon entering this state ------------------------------------------------
-        //Nothing: wait for mcm to say it's enabled
+static void MCM_enterStartupStage(MotorController* me, ubyte1 stage)
+{
+    ubyte4 elapsedMs;
 
-        //How to transition to next state ------------------------------------------------
-        if (MCM_getInverterStatus(me) == ENABLED)
+    //All timing is relative to HV coming up, so start a fresh log there
+    if (stage == MCM_STAGE_LOCKOUT)
+    {
+        IO_RTC_StartTime(&me->timeStamp_HVILHigh);
+        for (ubyte1 i = 0; i < MCM_STAGE_COUNT; i++)
         {
-            RTDPercent = 1; //Doesn't matter if button is no longer pressed - RTD light should be on if car is driveable
-            SerialManager_send(me->serialMan, "Inverter has been enabled.  Starting RTDS.  Car is ready to drive.\n");
-            RTDS_setVolume(rtds, 0, 1500000); // value 0 at normal testing (and 1 for the real ones, and of course at the comp), you dont want an eardrum rupture everytime right?
-            MCM_setStartupStage(me, 4); //MCM_setStartupStage(me, MCM_getStartupStage(me) + 1);  //leave this stage since we've already kicked off the RTDS
+            me->stageEnteredMs[i] = 0xFFFF;
         }
-        break;
+    }
 
-    case 4: //inverter=enabled, rtds=already started
-        //Actions to perform upon entering this state ------------------------------------------------
-        //If anything happened disabling inverter, MCM_relayControl(), the function right above this one, will catch it before this MCM_inverterControl() function and throw the state back to stage 0.
-        SerialManager_send(me->serialMan, "RTD procedure complete.\n");  //Just send a message
-        RTDPercent = 1; //RTD light should be on if car is driveable
+    elapsedMs = IO_RTC_GetTimeUS(me->timeStamp_HVILHigh) / 1000;
+    me->stageEnteredMs[stage] = (elapsedMs > 0xFFFE) ? 0xFFFE : elapsedMs;
+    me->startupTransitionCount++;
+    MCM_setStartupStage(me, stage);
+}
 
-        //How to transition to next state ------------------------------------------------
-        //Always do, since we sent a message.
-        MCM_setStartupStage(me, 5); //MCM_setStartupStage(me, MCM_getStartupStage(me) + 1);
-        break;
+//See diagram at https://onedrive.live.com/redir?resid=F9BB8F0F8FDB5CF8!30410&authkey=!ABSF-uVH-VxQRAs&ithint=file%2chtml
+void MCM_inverterControl(MotorController* me, TorqueEncoder* tps, BrakePressureSensor* bps, ReadyToDriveSound* rtds)
+{
+    StartupInputs inputs = { tps, bps, rtds };
+    ubyte1 stage = MCM_getStartupStage(me);
 
-    case 5: //inverter=enabled, rtds=already started, no safety fault occured
-        //What happens in this state ------------------------------------------------
-        //The car is safe to drive in this stage
-        RTDPercent = 1; //RTD light should be on if car is driveable
-        //This case is here so we don't send a message anymore
-        
-        //How to transition to next state ------------------------------------------------
-        //Don't. //no more MCM_setStartupStage(me, MCM_getStartupStage(me) + 1);
-        break;
+    if (stage >= MCM_STAGE_COUNT)
+    {
+        SerialManager_send(me->serialMan, "ERROR: Lost track of MCM startup status.\n");
+        return;
+    }
 
+    //----------------------------------------------------------------------------
+    // Take the first transition whose guard passes
+    //----------------------------------------------------------------------------
+    for (ubyte1 i = 0; i < STARTUP_TRANSITION_COUNT; i++)
+    {
+        const StartupTransition* row = &startupTransitions[i];
+        if ((row->from == stage || (row->from == MCM_STAGE_ANY && row->to != stage))
+            && row->guard(me, &inputs) == TRUE)
+        {
+            if (row->action != NULL)
+            {
+                row->action(me, &inputs);
+            }
+            if (row->message != NULL)
+            {
+                SerialManager_send(me->serialMan, row->message);
+            }
+            MCM_enterStartupStage(me, row->to);
+            stage = row->to;
+            break;
+        }
+    }
 
-    default:
-        SerialManager_send(me->serialMan, "ERROR: Lost track of MCM startup status.\n");
-        break;
+    //----------------------------------------------------------------------------
+    // Stage activity
+    //----------------------------------------------------------------------------
+    if (startupStates[stage].during != NULL)
+    {
+        startupStates[stage].during(me, &inputs);
     }
-    
-    //After all that, we can turn the RTD light on/off
-    Light_set(Light_dashRTD, RTDPercent);
 
+    //RTD light should be on if car is driveable, otherwise it just shows the button
+    Light_set(Light_dashRTD, (startupStates[stage].rtdLight == TRUE || Sensor_RTDButton.sensorValue == TRUE) ? 1 : 0);
 }
 
 
@@ -446,39 +596,67 @@ void MCM_parseCanMessage(MotorController* me, IO_CAN_DATA_FRAME* mcmCanMessage)
     //0xAA
     static const ubyte1 bitInverter = 1; //bit 0, 0000 0001
     static const ubyte1 bitLockout = 128; //bit 7, 1000 0000
+    //0xAB
+    ubyte4 faultsPOST;
+    ubyte4 faultsRUN;
+
+    //VCU debug control is on a fixed ID shared by every controller
+    if (mcmCanMessage->id == 0x5FF)
+    {
+        //Byte 1 = HVIL override request
+        if (mcmCanMessage->data[1] > 0)
+        {
+            IO_RTC_StartTime(&me->timeStamp_HVILOverrideCommandReceived);
+        }
+        return;
+    }
 
-    switch (mcmCanMessage->id)
+    //Everything else is relative to this controller's base ID (0xA0 = offset 0x00 on a stock RMS)
+    if (mcmCanMessage->id < me->canMessageBaseId || mcmCanMessage->id > me->canMessageBaseId + 0x0F)
     {
-    case 0x0A0:
+        return;
+    }
+
+    switch (mcmCanMessage->id - me->canMessageBaseId)
+    {
+    case 0x00:  //0xA0
         //0,1 module A temperature
         //2,3 module B temperature
         //4,5 module C temperature
         //6,7 gate driver board temperature
+        //All signed, 0.1 C
+        for (ubyte1 module = 0; module < 3; module++)
+        {
+            me->moduleTemp[module] = (sbyte2)((ubyte2)mcmCanMessage->data[module * 2 + 1] << 8 | mcmCanMessage->data[module * 2]) / 10;
+        }
+        me->gateDriverTemp = (sbyte2)((ubyte2)mcmCanMessage->data[7] << 8 | mcmCanMessage->data[6]) / 10;
+        me->moduleTempUpdateCount++;
         break;
 
-    case 0x0A1:
+    case 0x01:  //0xA1
         //0,1 control board temp
         //2,3 rtd 1 temp
         //4,5 rtd 2 temp
         //6,7 rtd 3 temp
         break;
 
-    case 0x0A2:
+    case 0x02:  //0xA2
         //0,1 rtd 4 temp
         //2,3 rtd 5 temp
         //4,5 motor temperature***
-        me->motor_temp = ((ubyte2)mcmCanMessage->data[5] << 8 | mcmCanMessage->data[4]) / 10;
+        me->motor_temp = (sbyte2)((ubyte2)mcmCanMessage->data[5] << 8 | mcmCanMessage->data[4]) / 10;  //Signed, 0.1 C
+        me->motorTempUpdateCount++;
         //6,7 torque shudder
         break;
 
-    case 0x0A3:
+    case 0x03:  //0xA3
         //0,1 voltage analog input #1
         //2,3 voltage analog input #2
         //4,5 voltage analog input #3
         //6,7 voltage analog input #4
         break;
 
-    case 0x0A4:
+    case 0x04:  //0xA4
         // booleans //
         // 0 digital input #1
         // 1 digital input #2
@@ -489,7 +667,7 @@ void MCM_parseCanMessage(MotorController* me, IO_CAN_DATA_FRAME* mcmCanMessage)
         // 7 digital input #8
         break;
 
-    case 0x0A5:
+    case 0x05:  //0xA5
         //0,1 motor angle (electrical)
         //2,3 motor speed*** // in rpms
         //Cast may be required - needs testing
@@ -499,39 +677,41 @@ void MCM_parseCanMessage(MotorController* me, IO_CAN_DATA_FRAME* mcmCanMessage)
         //6,7 delta resolver filtered
         break;
 
-    case 0x0A6:
+    case 0x06:  //0xA6
         //0,1 Phase A current
         //2,3 Phase B current
         //4,5 Phase C current
         //6,7 DC bus current
         me->DC_Current = ((ubyte2)mcmCanMessage->data[7] << 8 | mcmCanMessage->data[6]) / 10;
+        me->DC_Current_dA = (sbyte2)((ubyte2)mcmCanMessage->data[7] << 8 | mcmCanMessage->data[6]);
         //me->DC_Current = (((mcmCanMessage->data[6] << 8) | (mcmCanMessage->data[7])) / 10);
         break;
 
-    case 0x0A7:
+    case 0x07:  //0xA7
         //0,1 DC bus voltage***
         me->DC_Voltage = ((ubyte2)mcmCanMessage->data[1] << 8 | mcmCanMessage->data[0]) / 10;
+        me->DC_Voltage_dV = (sbyte2)((ubyte2)mcmCanMessage->data[1] << 8 | mcmCanMessage->data[0]);
         //me->DC_Voltage = (((mcmCanMessage->data[0] << 8) | (mcmCanMessage->data[1])) / 10);
         //2,3 output voltage
         //4,5 Phase AB voltage
         //6,7 Phase BC voltage
         break;
 
-    case 0x0A8:
+    case 0x08:  //0xA8
         //0,1 Flux Command
         //2,3 flux feedback
         //4,5 id feedback
         //6,7 iq feedback
         break;
 
-    case 0x0A9:
+    case 0x09:  //0xA9
         // 0,1 1.5V reference voltage
         // 2,3 2.5V reference voltage
         // 4,5 5.0V reference voltage
         // 6,7 12V reference voltage
         break;
 
-    case 0x0AA:
+    case 0x0A:  //0xAA
         //0,1 VSM state
         //2   Inverter state
         //3   Relay State
@@ -549,26 +729,28 @@ void MCM_parseCanMessage(MotorController* me, IO_CAN_DATA_FRAME* mcmCanMessage)
         break;
 
 
-    case 0x0AB: //Faults
-        //mcmCanMessage->data;
-        //me->faultHistory |= data stuff //????????
-
-        break;
-
-
-    case 0x0AC:
-        //0,1 Commanded Torque
-        me->commandedTorque = ((ubyte2)mcmCanMessage->data[1] << 8 | mcmCanMessage->data[0]) / 10;
-        //2,3 Torque Feedback
+    case 0x0B:  //0xAB: Faults
+        //0,1 POST fault lo, 2,3 POST fault hi, 4,5 RUN fault lo, 6,7 RUN fault hi
+        faultsPOST = (ubyte4)mcmCanMessage->data[0] | ((ubyte4)mcmCanMessage->data[1] << 8)
+            | ((ubyte4)mcmCanMessage->data[2] << 16) | ((ubyte4)mcmCanMessage->data[3] << 24);
+        faultsRUN = (ubyte4)mcmCanMessage->data[4] | ((ubyte4)mcmCanMessage->data[5] << 8)
+            | ((ubyte4)mcmCanMessage->data[6] << 16) | ((ubyte4)mcmCanMessage->data[7] << 24);
+        if (faultsPOST != me->faultCodesPOST || faultsRUN != me->faultCodesRUN)
+        {
+            me->faultCodesPOST = faultsPOST;
+            me->faultCodesRUN = faultsRUN;
+            me->faultUpdateCount++;
+        }
+        for (ubyte1 i = 0; i < 8; i++)
+        {
+            me->faultHistory[i] |= mcmCanMessage->data[i];
+        }
         break;
 
 
-    case 0x5FF:
+    case 0x0C:  //0xAC
         //0,1 Commanded Torque
-        if (mcmCanMessage->data[1] > 0)
-        {
-            IO_RTC_StartTime(&me->timeStamp_HVILOverrideCommandReceived);
-        }
+        me->commandedTorque = (sbyte2)((ubyte2)mcmCanMessage->data[1] << 8 | mcmCanMessage->data[0]) / 10;  //Signed (regen < 0)
         //2,3 Torque Feedback
         break;
 
@@ -706,31 +888,66 @@ ubyte2 MCM_getTorqueMax(MotorController* me)
 
 
 
+//DC bus power in watts (from the 0.1 V / 0.1 A values, not the rounded ones)
 sbyte4 MCM_getPower(MotorController* me)
 {
-	return ((me->DC_Voltage) * (me->DC_Current));
+	return ((sbyte4)me->DC_Voltage_dV * me->DC_Current_dA) / 100;
 }
 
-ubyte2 MCM_getCommandedTorque(MotorController* me)
+sbyte2 MCM_getCommandedTorque(MotorController* me)
 {
 	return me->commandedTorque;
 }
 
 
+//Motor controller temp = hottest power module
 sbyte2 MCM_getTemp(MotorController* me)
 {
-    return me->motor_temp;  //TODO: Figure out which temperature to return for Motor Controller
+    sbyte2 hottest = me->moduleTemp[0];
+    if (me->moduleTemp[1] > hottest) { hottest = me->moduleTemp[1]; }
+    if (me->moduleTemp[2] > hottest) { hottest = me->moduleTemp[2]; }
+    return hottest;
+}
+
+ubyte2 MCM_getModuleTempUpdateCount(MotorController* me)
+{
+    return me->moduleTempUpdateCount;
+}
+
+ubyte2 MCM_getMotorTempUpdateCount(MotorController* me)
+{
+    return me->motorTempUpdateCount;
+}
+
+ubyte4 MCM_getPostFaults(MotorController* me)
+{
+    return me->faultCodesPOST;
+}
+
+ubyte4 MCM_getRunFaults(MotorController* me)
+{
+    return me->faultCodesRUN;
+}
+
+ubyte2 MCM_getFaultUpdateCount(MotorController* me)
+{
+    return me->faultUpdateCount;
 }
 sbyte2 MCM_getMotorTemp(MotorController* me)
 {
     return me->motor_temp;
 }
 
+sbyte2 MCM_getMotorRPM(MotorController* me)
+{
+    return me->motorRPM;
+}
+
 sbyte2 MCM_getGroundSpeedKPH(MotorController* me)
 {
-    sbyte2 wheelRPM = me->motorRPM / 3;
+    float4 wheelRPM = me->motorRPM / 3.0;
     float4 tireCircumference = 3.141592653589 * 18 * .0254; // (pi * diameter * in to m) = circumference in meters
-    sbyte2 groundKPH = wheelRPM / 60 * tireCircumference;
+    sbyte2 groundKPH = wheelRPM * tireCircumference * 60 / 1000;  //rev/min * m/rev * min/hr * km/m
     return groundKPH;
 }
 
@@ -770,7 +987,27 @@ void MCM_setStartupStage(MotorController* me, ubyte1 stage)
 	me->startupStage = stage;
 }
 
+ubyte2 MCM_getCanMessageBaseId(MotorController* me)
+{
+    return me->canMessageBaseId;
+}
+
+ubyte2 MCM_getCommandMessageId(MotorController* me)
+{
+    return me->canMessageBaseId + MCM_COMMAND_ID_OFFSET;
+}
+
 ubyte1 MCM_getStartupStage(MotorController* me)
 {
 	return me->startupStage;
 }
+
+ubyte2 MCM_getStageEnteredMs(MotorController* me, ubyte1 stage)
+{
+    return me->stageEnteredMs[stage];
+}
+
+ubyte1 MCM_getStartupTransitionCount(MotorController* me)
+{
+    return me->startupTransitionCount;
+}
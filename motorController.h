@@ -7,6 +7,7 @@
 #include "torqueEncoder.h"
 #include "brakePressureSensor.h"
 #include "readyToDriveSound.h"
+#include "torqueMap.h"
 //#include "safety.h"
 #include "serial.h"
 
@@ -18,8 +19,27 @@ typedef enum { ENABLED, DISABLED, UNKNOWN } Status;
 //1 = CCW = FORWARD (for our car)
 typedef enum { CLOCKWISE, COUNTERCLOCKWISE, FORWARD, REVERSE, _0, _1 } Direction;
 
+//Ready-to-drive startup stages (see MCM_inverterControl).  These numbers are
+//reported on CAN (0x509 byte 7, 0x50E), so don't renumber them.
+typedef enum
+{
+    MCM_STAGE_OFF,            //0: MCM relay off / HV down
+    MCM_STAGE_LOCKOUT,        //1: relay on, inverter lockout still enabled
+    MCM_STAGE_WAIT_RTD,       //2: lockout disabled, waiting for RTD button
+    MCM_STAGE_WAIT_INVERTER,  //3: inverter enable commanded, waiting for MCM
+    MCM_STAGE_RTD_COMPLETE,   //4: inverter enabled, RTDS started
+    MCM_STAGE_DRIVE,          //5: ready to drive
+    MCM_STAGE_COUNT
+} MCMStartupStage;
+
 typedef struct _MotorController MotorController;
 
+//Number of motor controllers that can be created (each _new takes one from a static pool)
+#define MCM_CONTROLLERS_MAX 4
+//Each controller broadcasts on base + 0x00..0x0F and listens for commands on base + this (0xA0 -> 0xC0)
+#define MCM_COMMAND_ID_OFFSET 0x20
+
+//Returns NULL once MCM_CONTROLLERS_MAX controllers exist
 MotorController* MotorController_new(SerialManager* sm, ubyte2 canMessageBaseID, Direction initialDirection, sbyte2 torqueMaxInDNm, sbyte1 minRegenSpeedKPH, sbyte1 regenRampdownStartSpeed);
 
 //----------------------------------------------------------------------------
@@ -59,7 +79,7 @@ Status MCM_getLockoutStatus(MotorController* me);
 Status MCM_getInverterStatus(MotorController* me);
 
 sbyte4 MCM_getPower(MotorController* me);
-ubyte2 MCM_getCommandedTorque(MotorController* me);
+sbyte2 MCM_getCommandedTorque(MotorController* me);  //0xAC, whole Nm
 
 bool MCM_getHvilOverrideStatus(MotorController* me);
 
@@ -71,9 +91,16 @@ bool MCM_getRTDSFlag(MotorController* me);
 //void motorController_SendControlMessage(IO_CAN_DATA_FRAME *canMessage); //This is an alias for canOutput_sendMcuControl
 //void motorController_setAllCommands(ReadyToDriveSound* rtds);
 
-sbyte2 MCM_getTemp(MotorController* me);
+sbyte2 MCM_getTemp(MotorController* me);  //Hottest inverter power module, C
 sbyte2 MCM_getMotorTemp(MotorController* me);
+ubyte2 MCM_getModuleTempUpdateCount(MotorController* me);  //Changes whenever 0xA0 arrives (0 = MCM_getTemp not valid yet)
+ubyte2 MCM_getMotorTempUpdateCount(MotorController* me);   //Changes whenever 0xA2 arrives (0 = MCM_getMotorTemp not valid yet)
+
+ubyte4 MCM_getPostFaults(MotorController* me);  //Latest 0xAB bytes 0-3
+ubyte4 MCM_getRunFaults(MotorController* me);   //Latest 0xAB bytes 4-7
+ubyte2 MCM_getFaultUpdateCount(MotorController* me);
 
+sbyte2 MCM_getMotorRPM(MotorController* me);
 sbyte2 MCM_getGroundSpeedKPH(MotorController* me);
 sbyte1 MCM_getRegenMinSpeed(MotorController* me);
 sbyte1 MCM_getRegenRampdownStartSpeed(MotorController* me);
@@ -88,14 +115,18 @@ sbyte2 MCM_getRegenAPPSForMaxCoastingZeroToFF(MotorController* me);
 //Inter-object functions
 //----------------------------------------------------------------------------
 void MCM_readTCSSettings(MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSwitchDown, Sensor* TCSPot);
-void MCM_calculateCommands(MotorController* mcm, TorqueEncoder* tps, BrakePressureSensor* bps);
+void MCM_calculateCommands(MotorController* mcm, TorqueEncoder* tps, BrakePressureSensor* bps, TorqueMap* map);
 
 void MCM_relayControl(MotorController* mcm, Sensor* HVILTermSense);
 void MCM_inverterControl(MotorController* mcm, TorqueEncoder* tps, BrakePressureSensor* bps, ReadyToDriveSound* rtds);
 
-void MCM_parseCanMessage(MotorController* mcm, IO_CAN_DATA_FRAME* mcmCanMessage);
+void MCM_parseCanMessage(MotorController* mcm, IO_CAN_DATA_FRAME* mcmCanMessage);  //Base ID + 0x00..0x0F, and 0x5FF
+ubyte2 MCM_getCanMessageBaseId(MotorController* me);
+ubyte2 MCM_getCommandMessageId(MotorController* me);
 
 ubyte1 MCM_getStartupStage(MotorController* me);
 void MCM_setStartupStage(MotorController* me, ubyte1 stage);
+ubyte2 MCM_getStageEnteredMs(MotorController* me, ubyte1 stage);  //ms after HVIL high, 0xFFFF = not reached since HVIL high
+ubyte1 MCM_getStartupTransitionCount(MotorController* me);
 
 #endif // _MOTORCONTROLLER_H
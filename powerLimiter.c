@@ -0,0 +1,180 @@
+#include "IO_Driver.h"
+
+#include "powerLimiter.h"
+#include "motorController.h"
+#include "bms.h"
+
+#define POWER_WINDOW_SHORT_US 100000
+#define POWER_WINDOW_LONG_US 500000
+
+#define Q10_ONE 1024
+
+//PI gains (Q10).  Integral is in W x cycles, clamped so it can pull the
+//allowed power down by at most POWER_INTEGRAL_MAX_W worth.
+#define POWER_KP_Q10 512    //0.5 W allowed per W of error
+#define POWER_KI_Q10 64     //1/16 W per W x cycle
+#define POWER_INTEGRAL_MAX (20000L * Q10_ONE / POWER_KI_Q10)
+
+//Multiplier can drop immediately but only recovers this much per cycle
+#define POWER_RECOVERY_Q10 16
+
+//One source's moving averages
+typedef struct
+{
+    sbyte4 samples[POWER_HISTORY_MAX];
+    sbyte4 sumShort;
+    sbyte4 sumLong;
+} PowerHistory;
+
+struct _PowerLimiter
+{
+    sbyte4 targetW;     //Lower of the rules target and any cap (see PowerLimiter_setCapW)
+    sbyte4 rulesTargetW;
+    ubyte1 shortCount;  //Samples per window
+    ubyte1 longCount;
+    ubyte1 head;        //Next slot to write (same for both sources)
+
+    PowerHistory bms;
+    PowerHistory mcm;
+    sbyte4 instantW;
+
+    sbyte4 integral;
+    sbyte2 multiplierQ10;
+};
+
+static struct _PowerLimiter powerLimiterInstance;
+
+PowerLimiter* PowerLimiter_new(ubyte4 cyclePeriodUs, sbyte4 targetW)
+{
+    PowerLimiter* me = &powerLimiterInstance;
+    ubyte4 longCount = (POWER_WINDOW_LONG_US + cyclePeriodUs - 1) / cyclePeriodUs;   //Round up: never shorter than the rule
+    ubyte4 shortCount = (POWER_WINDOW_SHORT_US + cyclePeriodUs - 1) / cyclePeriodUs;
+
+    me->targetW = me->rulesTargetW = targetW;
+    me->longCount = (longCount > POWER_HISTORY_MAX) ? POWER_HISTORY_MAX : (longCount < 1) ? 1 : longCount;
+    me->shortCount = (shortCount > me->longCount) ? me->longCount : (shortCount < 1) ? 1 : shortCount;
+    me->head = 0;
+
+    for (ubyte1 i = 0; i < POWER_HISTORY_MAX; i++)
+    {
+        me->bms.samples[i] = 0;
+        me->mcm.samples[i] = 0;
+    }
+    me->bms.sumShort = me->bms.sumLong = 0;
+    me->mcm.sumShort = me->mcm.sumLong = 0;
+    me->instantW = 0;
+
+    me->integral = 0;
+    me->multiplierQ10 = Q10_ONE;
+
+    return me;
+}
+
+//Adds the newest sample and drops the one that just left each window
+static void PowerLimiter_addSample(PowerLimiter* me, PowerHistory* history, sbyte4 powerW)
+{
+    ubyte1 leavingShort = (me->head + POWER_HISTORY_MAX - me->shortCount) % POWER_HISTORY_MAX;
+    ubyte1 leavingLong = (me->head + POWER_HISTORY_MAX - me->longCount) % POWER_HISTORY_MAX;
+
+    history->sumShort += powerW - history->samples[leavingShort];
+    history->sumLong += powerW - history->samples[leavingLong];
+    history->samples[me->head] = powerW;
+}
+
+void PowerLimiter_update(PowerLimiter* me, MotorController* mcm, BatteryManagementSystem* bms)
+{
+    sbyte4 bmsW = BMS_getPower(bms);
+    sbyte4 mcmW = MCM_getPower(mcm);
+    sbyte4 averageW;
+    sbyte4 error;
+    sbyte4 allowedW;
+    sbyte4 newMultiplier;
+
+    //----------------------------------------------------------------------------
+    // Averages
+    //----------------------------------------------------------------------------
+    PowerLimiter_addSample(me, &me->bms, bmsW);
+    PowerLimiter_addSample(me, &me->mcm, mcmW);
+    me->head = (me->head + 1) % POWER_HISTORY_MAX;
+    me->instantW = (bmsW > mcmW) ? bmsW : mcmW;
+
+    //Whichever window is closer to breaking the rule
+    averageW = PowerLimiter_getAverageW(me, POWER_WINDOW_SHORT);
+    if (PowerLimiter_getAverageW(me, POWER_WINDOW_LONG) > averageW)
+    {
+        averageW = PowerLimiter_getAverageW(me, POWER_WINDOW_LONG);
+    }
+
+    //----------------------------------------------------------------------------
+    // PI: trim the allowed power by how far the averages are from the target.
+    // Integral only ever pulls down (<= 0), and bleeds back toward 0 below target.
+    //----------------------------------------------------------------------------
+    error = me->targetW - averageW;
+    me->integral += error;
+    if (me->integral > 0) { me->integral = 0; }
+    if (me->integral < -POWER_INTEGRAL_MAX) { me->integral = -POWER_INTEGRAL_MAX; }
+
+    allowedW = me->targetW
+             + ((error < 0 ? error : 0) * POWER_KP_Q10 >> 10)
+             + (me->integral * POWER_KI_Q10 >> 10);
+    if (allowedW < 0) { allowedW = 0; }
+
+    //----------------------------------------------------------------------------
+    // Feedforward: the latest power was made with the last multiplier, so scale
+    // that multiplier by allowed / actual
+    //----------------------------------------------------------------------------
+    if (me->instantW > allowedW && me->instantW > 0)
+    {
+        newMultiplier = (sbyte4)me->multiplierQ10 * allowedW / me->instantW;
+    }
+    else
+    {
+        newMultiplier = me->multiplierQ10 + POWER_RECOVERY_Q10;
+    }
+
+    if (newMultiplier > Q10_ONE) { newMultiplier = Q10_ONE; }
+    if (newMultiplier < 0) { newMultiplier = 0; }
+    me->multiplierQ10 = (sbyte2)newMultiplier;
+}
+
+void PowerLimiter_setCapW(PowerLimiter* me, sbyte4 capW)
+{
+    me->targetW = (capW < me->rulesTargetW) ? capW : me->rulesTargetW;
+}
+
+sbyte4 PowerLimiter_getTargetW(PowerLimiter* me)
+{
+    return me->targetW;
+}
+
+float4 PowerLimiter_getMultiplier(PowerLimiter* me)
+{
+    return (float4)me->multiplierQ10 / Q10_ONE;
+}
+
+sbyte4 PowerLimiter_getBMSAverageW(PowerLimiter* me, PowerWindow window)
+{
+    return (window == POWER_WINDOW_SHORT) ? me->bms.sumShort / me->shortCount : me->bms.sumLong / me->longCount;
+}
+
+sbyte4 PowerLimiter_getMCMAverageW(PowerLimiter* me, PowerWindow window)
+{
+    return (window == POWER_WINDOW_SHORT) ? me->mcm.sumShort / me->shortCount : me->mcm.sumLong / me->longCount;
+}
+
+sbyte4 PowerLimiter_getAverageW(PowerLimiter* me, PowerWindow window)
+{
+    sbyte4 bmsW = PowerLimiter_getBMSAverageW(me, window);
+    sbyte4 mcmW = PowerLimiter_getMCMAverageW(me, window);
+    return (bmsW > mcmW) ? bmsW : mcmW;
+}
+
+sbyte4 PowerLimiter_getInstantW(PowerLimiter* me)
+{
+    return me->instantW;
+}
+
+bool PowerLimiter_isLimiting(PowerLimiter* me)
+{
+    return me->multiplierQ10 < Q10_ONE;
+}
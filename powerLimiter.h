@@ -0,0 +1,52 @@
+#ifndef _POWERLIMITER_H
+#define _POWERLIMITER_H
+
+#include "IO_Driver.h"
+#include "motorController.h"
+#include "bms.h"
+
+/*****************************************************************************
+* Power Limiter
+******************************************************************************
+* Keeps tractive system power under the 80 kW rules limit (judged on 100 ms
+* and 500 ms moving averages) by aiming a little lower (the target).
+*
+* Averaging: DC power from the BMS (pack V x I) and the MCM (DC bus V x I) is
+* sampled once per main loop into a ring buffer per source, with running sums
+* for both windows - adding a sample is O(1) no matter the window length.
+* The higher of the two sources is what gets limited.
+*
+* Control: the torque multiplier is adjusted every cycle by
+*   - feedforward: latest (instantaneous) power vs the allowed power.  Since
+*     DC voltage x current is measured fresh every cycle, pack sag shows up
+*     here right away, before it moves the averages.
+*   - PI feedback: the averages' error vs the target trims the allowed power
+*     so the averages settle at the target instead of just under the
+*     instantaneous limit.
+* Everything is integer (W, Q10 multiplier).  Only discharge is limited.
+****************************************************************************/
+
+//Samples kept per source - must cover the long window (500 ms at the main loop period)
+#define POWER_HISTORY_MAX 32
+
+typedef enum { POWER_WINDOW_SHORT, POWER_WINDOW_LONG } PowerWindow;  //100 ms, 500 ms
+
+typedef struct _PowerLimiter PowerLimiter;
+
+PowerLimiter* PowerLimiter_new(ubyte4 cyclePeriodUs, sbyte4 targetW);
+
+//Call once per cycle after CanManager_read
+void PowerLimiter_update(PowerLimiter* me, MotorController* mcm, BatteryManagementSystem* bms);
+
+//Extra cap on top of the rules target (e.g. EcoMode).  The lower of the two is used.
+void PowerLimiter_setCapW(PowerLimiter* me, sbyte4 capW);
+sbyte4 PowerLimiter_getTargetW(PowerLimiter* me);
+
+float4 PowerLimiter_getMultiplier(PowerLimiter* me);  //0 to 1
+sbyte4 PowerLimiter_getAverageW(PowerLimiter* me, PowerWindow window);  //Higher of BMS/MCM
+sbyte4 PowerLimiter_getBMSAverageW(PowerLimiter* me, PowerWindow window);
+sbyte4 PowerLimiter_getMCMAverageW(PowerLimiter* me, PowerWindow window);
+sbyte4 PowerLimiter_getInstantW(PowerLimiter* me);
+bool PowerLimiter_isLimiting(PowerLimiter* me);
+
+#endif //  _POWERLIMITER_H
@@ -0,0 +1,93 @@
+#------------------------------------------------------------------------------
+# ramMap.ps1
+#------------------------------------------------------------------------------
+# Prints a RAM usage report from the linker's XML map file so we know how much
+# RAM the VCU objects take before flashing.  Run via "make rammap" (also runs
+# at the end of every "make").
+#
+# All VCU objects are statically allocated (no malloc), so everything shows up
+# here as .data/.bss - the numbers are the real RAM footprint.
+#
+# The XML layout differs a little between linker versions, so fields are looked
+# up by name as either attributes or child elements.
+#------------------------------------------------------------------------------
+param([string]$MapFile = "build\main.mapxml", [int]$Top = 25)
+
+function Get-Field($node, [string[]]$names)
+{
+    foreach ($n in $names)
+    {
+        if ($node.Attributes -and $node.Attributes[$n]) { return $node.Attributes[$n].Value }
+        $child = $node.SelectSingleNode($n)
+        if ($child) { return $child.InnerText }
+    }
+    return $null
+}
+
+function Convert-Size([string]$text)
+{
+    if (-not $text) { return 0 }
+    $text = $text.Trim()
+    if ($text -match '^0x([0-9a-fA-F]+)$') { return [Convert]::ToInt64($matches[1], 16) }
+    if ($text -match '^[0-9]+$') { return [int64]$text }
+    return 0
+}
+
+if (-not (Test-Path $MapFile))
+{
+    Write-Host "ramMap: $MapFile not found - build first"
+    exit 0
+}
+
+try
+{
+    [xml]$map = Get-Content $MapFile
+}
+catch
+{
+    Write-Host "ramMap: could not parse $MapFile"
+    exit 0
+}
+
+#Anything with a name and a size that lives in a RAM (data/bss) section
+$ramPattern   = '(\.bss|\.data|bss|data|ram)'
+$notRamPattern = '(rodata|const|code|text|rom|flash|vector|\.debug)'
+
+$entries = @()
+foreach ($node in $map.SelectNodes("//*"))
+{
+    $name = Get-Field $node @("name", "Name", "symbol", "Symbol")
+    $size = Convert-Size (Get-Field $node @("size", "Size", "length", "Length"))
+    if (-not $name -or $size -le 0) { continue }
+
+    $section = Get-Field $node @("section", "Section", "space", "Space", "type", "Type")
+    $where = "$section $name"
+    if ($where -notmatch $ramPattern -or $where -match $notRamPattern) { continue }
+
+    $module = Get-Field $node @("module", "Module", "file", "File", "object", "Object")
+    if (-not $module) { $module = "(unknown)" }
+
+    $entries += New-Object PSObject -Property @{ Name = $name; Module = [IO.Path]::GetFileName($module); Size = $size }
+}
+
+if ($entries.Count -eq 0)
+{
+    Write-Host "ramMap: no RAM sections found in $MapFile"
+    exit 0
+}
+
+Write-Host "------------------------------------------------------------"
+Write-Host " RAM usage by module"
+Write-Host "------------------------------------------------------------"
+$entries | Group-Object Module | ForEach-Object {
+    New-Object PSObject -Property @{ Module = $_.Name; Bytes = ($_.Group | Measure-Object Size -Sum).Sum }
+} | Sort-Object Bytes -Descending | Format-Table Module, Bytes -AutoSize
+
+Write-Host "------------------------------------------------------------"
+Write-Host " Largest $Top RAM objects"
+Write-Host "------------------------------------------------------------"
+$entries | Sort-Object Size -Descending | Select-Object -First $Top | Format-Table Name, Module, Size -AutoSize
+
+$total = ($entries | Measure-Object Size -Sum).Sum
+Write-Host "Total static RAM: $total bytes"
+exit 0
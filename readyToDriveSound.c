@@ -1,4 +1,3 @@
-#include <stdlib.h>  //Needed for malloc
 
 #include "IO_Driver.h"  //Includes datatypes, constants, etc - should be included in every c file
 #include "IO_DIO.h"
@@ -12,21 +11,15 @@ struct _ReadyToDriveSound
     ubyte2 volumePercent;
 };
 
+static struct _ReadyToDriveSound rtdsInstance;
+
 ReadyToDriveSound* RTDS_new(void)
 {
-    ReadyToDriveSound* rtds = (ReadyToDriveSound*) malloc(sizeof(struct _ReadyToDriveSound));
+    ReadyToDriveSound* rtds = &rtdsInstance;
     RTDS_setVolume(rtds, 0, 1000000); //1,000,000 micro-seconds is 1 second
     return rtds;
 }
 
-void RTDS_delete(ReadyToDriveSound* rtds)
-{
-    // some implementations pass a Person** to set the reference to 0
-    // this implementation requires that the caller sets his own references to 0
-    //free(person->name);
-    free(rtds);
-}
-
 void RTDS_setVolume(ReadyToDriveSound* rtds, float4 volumePercent, ubyte4 timeToPlay)
 {    
    if(volumePercent == 0){
@@ -1,4 +1,3 @@
-#include <stdlib.h> //malloc
 //#include <math.h>
 #include "IO_Driver.h"
 #include "IO_RTC.h"
@@ -17,96 +16,282 @@
 #include "bms.h"
 #include "serial.h"
 
-//----------------------------------------------------------------------------
-//Faults
-//last flag is 0x 8000 0000 (32 flags, 8 hex characters)
-//----------------------------------------------------------------------------
-//nibble 1
-static const ubyte4 F_tpsOutOfRange = 1;
-static const ubyte4 F_bpsOutOfRange = 2;
-static const ubyte4 F_tpsPowerFailure = 4;
-static const ubyte4 F_bpsPowerFailure = 8;
-//nibble 2
-static const ubyte4 F_tpsSignalFailure = 0x10;
-static const ubyte4 F_bpsSignalFailure = 0x20;
-static const ubyte4 F_tpsNotCalibrated = 0x40;
-static const ubyte4 F_bpsNotCalibrated = 0x80;
-
-//nibble 3
-static const ubyte4 F_tpsOutOfSync = 0x100;
-static const ubyte4 F_bpsOutOfSync = 0x200; //NOT USED
-static const ubyte4 F_tpsbpsImplausible = 0x400;
-//static const ubyte4 UNUSED = 0x800;
-
-//nibble 4
-//static const ubyte4 F_ = 0x1000;
-//static const ubyte4 F_ = 0x2000;
-//static const ubyte4 F_ = 0x4000;
-//static const ubyte4 F_ = 0x8000;
-
-//nibble 5
-static const ubyte4 F_lvsBatteryVeryLow = 0x10000;
-//static const ubyte4 F_ = 0x20000;
-//static const ubyte4 F_ = 0x40000;
-//static const ubyte4 F_ = 0x80000;
-
-//nibble 6
-//nibble 7
-//nibble 8
-//                             nibble: 87654321
-static const ubyte4 F_unusedFaults = 0xFFFEF800;
-
-
-//Warnings -------------------------------------------
-static const ubyte2 W_lvsBatteryLow = 1;
-static const ubyte2 W_hvilOverrideEnabled = 0x40;  //This flag indicates HVIL bypass (MCM turn on)
-static const ubyte2 W_safetyBypassEnabled = 0x80;  //This flag controls the safety bypass
-
-//Notices
-static const ubyte2 N_HVILTermSenseLost = 1;
-
-static const ubyte2 N_Over75kW_BMS = 0x10;
-static const ubyte2 N_Over75kW_MCM = 0x20;
-
+//Room for this many rules (see safetyRules[] below)
+#define SAFETY_RULES_MAX 32
 
 /*****************************************************************************
 * SafetyChecker object
 ******************************************************************************
-* ToDo: change to ubyte1[8] (64 flags possible)
+* flags: 64 flags (SafetyFlag), bit n of the set = flags[n / 8] bit n % 8
 * 1 = fault
 * 0 = no fault
 ****************************************************************************/
 struct _SafetyChecker {
 	//Problems that require motor torque to be disabled
     SerialManager* serialMan;
-    ubyte4 faults;
-    ubyte2 warnings;
-    ubyte2 notices;
-    ubyte1 maxAmpsCharge;
-    ubyte1 maxAmpsDischarge;
-
-    bool tpsbpsImplausible;
+    ubyte1 flags[8];
+    ubyte2 updateCount;  //Incremented whenever any flag changes (for telemetry)
+    ubyte2 maxAmpsCharge;
+    ubyte2 maxAmpsDischarge;
+
+    //Per rule (same index as safetyRules[])
+    ubyte1 setCycles[SAFETY_RULES_MAX];       //setMs in main loop cycles
+    ubyte1 clearCycles[SAFETY_RULES_MAX];     //clearMs in main loop cycles
+    ubyte1 pendingCycles[SAFETY_RULES_MAX];   //Consecutive cycles the rule has wanted its flag changed
+    ubyte2 ruleMaxUs[SAFETY_RULES_MAX];       //Slowest evaluation seen
+    ubyte2 evaluationMaxUs;                   //Slowest pass over the whole table
 
     bool bypass;
 	ubyte4 timestamp_bypassSafetyChecks;
 	ubyte4 bypassSafetyChecksTimeout_us;
 };
 
+static struct _SafetyChecker safetyCheckerInstance;
+
+/*****************************************************************************
+* Safety rules
+******************************************************************************
+* Each cycle SafetyChecker_update fills in a SafetyInputs and walks
+* safetyRules[] top to bottom.  For each rule:
+*
+*   set() TRUE  -> flag sets
+*   set() FALSE -> SAFETY_LATCH_NONE:    flag clears
+*                  SAFETY_LATCH_CLEAR:   flag clears only when clear() is TRUE
+*                  SAFETY_LATCH_RESTART: flag stays set until the VCU restarts
+*
+* Debounce: a flag only sets once the rule has asked for it for setMs
+* straight, and only clears once the rule has asked for that for clearMs
+* straight (0 = on the first sample).  One counter per rule does both -
+* it counts cycles in a row that disagree with the flag, and any sample
+* that agrees starts it over.  Faults that the rules say must cut power
+* within 100 ms (EV2.3.5/6) need margin for setMs, plus up to a cycle
+* before the first bad sample, plus the cycle that sends 0 torque - at
+* 33 ms cycles that's setMs 33 (~70 ms worst case).
+*
+* A rule's severity is its flag's number range (faults 0-31, warnings 32-47,
+* notices 48-63 - see SafetyFlag), which also decides the word of the 0x506
+* frame it lives in.  Any fault zeroes torque in SafetyChecker_reduceTorque.
+* To add a check, write a condition and add a row.  Conditions only read.
+*
+* Each rule's evaluation is timed with the RTC, and the slowest time seen per
+* rule goes out on 0x50F.
+****************************************************************************/
+typedef struct _SafetyInputs {
+    MotorController* mcm;
+    BatteryManagementSystem* bms;
+    TorqueEncoder* tps;
+    BrakePressureSensor* bps;
+    Sensor* HVILTermSense;
+    Sensor* LVBattery;
+    PowerLimiter* power;
+} SafetyInputs;
+
+typedef bool (*SafetyCondition)(SafetyChecker* me, const SafetyInputs* in);
+
+typedef enum { SAFETY_LATCH_NONE, SAFETY_LATCH_CLEAR, SAFETY_LATCH_RESTART } SafetyLatch;
+
+typedef struct _SafetyRule {
+    SafetyCondition set;
+    SafetyCondition clear;    //Only used by SAFETY_LATCH_CLEAR
+    SafetyFlag flag;
+    SafetyLatch latch;
+    ubyte2 setMs;
+    ubyte2 clearMs;
+    const char* message;      //Sent to serial when the flag sets, NULL = none
+} SafetyRule;
+
+//---------------------------------------------------------------------------
+// Conditions
+//---------------------------------------------------------------------------
+static bool safety_tpsNotCalibrated(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->tps->calibrated == FALSE;
+}
+
+static bool safety_bpsNotCalibrated(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->bps->calibrated == FALSE;
+}
+
+//Check if VCU was able to get a TPS/BPS reading
+static bool safety_tpsPowerFailure(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->tps->tps0->ioErr_powerInit != IO_E_OK
+        || in->tps->tps1->ioErr_powerInit != IO_E_OK
+        || in->tps->tps0->ioErr_powerSet != IO_E_OK
+        || in->tps->tps1->ioErr_powerSet != IO_E_OK;
+}
+
+static bool safety_tpsSignalFailure(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->tps->tps0->ioErr_signalInit != IO_E_OK
+        || in->tps->tps1->ioErr_signalInit != IO_E_OK
+        || in->tps->tps0->ioErr_signalGet != IO_E_OK
+        || in->tps->tps1->ioErr_signalGet != IO_E_OK;
+}
+
+static bool safety_bpsPowerFailure(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->bps->bps0->ioErr_powerInit != IO_E_OK
+        || in->bps->bps0->ioErr_powerSet != IO_E_OK;
+}
+
+static bool safety_bpsSignalFailure(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->bps->bps0->ioErr_signalInit != IO_E_OK
+        || in->bps->bps0->ioErr_signalGet != IO_E_OK;
+}
+
+//RULE: EV2.3.10 - signal outside of operating range is considered a failure
+//  This refers to SPEC SHEET values, not calibration values
+//Note: IC cars may continue to drive for up to 100ms until valid readings are restored, but EVs must immediately cut power
+static bool safety_tpsOutOfRange(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->tps->tps0->sensorValue < in->tps->tps0->specMin || in->tps->tps0->sensorValue > in->tps->tps0->specMax
+        || in->tps->tps1->sensorValue < in->tps->tps1->specMin || in->tps->tps1->sensorValue > in->tps->tps1->specMax;
+}
+
+static bool safety_bpsOutOfRange(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->bps->bps0->sensorValue < in->bps->bps0->specMin || in->bps->bps0->sensorValue > in->bps->bps0->specMax;
+}
+
+// EV2.3.5 If an implausibility occurs between the values of these two sensors
+//  the power to the motor(s) must be immediately shut down completely. It is not necessary 
+//  to completely deactivate the tractive system, the motor controller(s) shutting down the 
+//  power to the motor(s) is sufficient.
+// EV2.3.6 Implausibility is defined as a deviation of more than 10 % pedal travel between the sensors.
+static bool safety_tpsOutOfSync(SafetyChecker* me, const SafetyInputs* in)
+{
+	float4 tps0Percent;   //Pedal percent float (a decimal between 0 and 1
+	float4 tps1Percent;
+
+	TorqueEncoder_getIndividualSensorPercent(in->tps, 0, &tps0Percent);
+	TorqueEncoder_getIndividualSensorPercent(in->tps, 1, &tps1Percent);
+
+    //Note: Individual TPS readings don't go negative, otherwise this wouldn't work
+    return (tps1Percent - tps0Percent) > .1 || (tps1Percent - tps0Percent) < -.1;
+}
+
+// EV2.5 Torque Encoder / Brake Pedal Plausibility Check
+//  The power to the motors must be immediately shut down completely, if the mechanical brakes 
+//  are actuated and the torque encoder signals more than 25 % pedal travel at the same time.
+//  This must be demonstrated when the motor controllers are under load.
+static bool safety_tpsbpsImplausible(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->bps->percent > .05 && in->tps->percent > .25;
+}
+
+// EV2.5.1 The motor power shut down must remain active until the torque encoder signals less than 5 % pedal travel,
+//  no matter whether the brakes are still actuated or not.
+static bool safety_tpsbpsPlausibleAgain(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->tps->percent < .05;
+}
+
+//  IO_ADC_UBAT: 0..40106  (0V..40.106V)
+static bool safety_lvsBatteryVeryLow(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->LVBattery->sensorValue <= 9200;  //12730 = 10% SOC but hard to tell under load. 9200 = empty
+}
+
+static bool safety_lvsBatteryLow(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->LVBattery->sensorValue <= 12730;  //13100 = Recharge percentage, per Shorai
+}
+
+// The safety checker should only be bypassed by a CAN message sent by
+// the PCAN Explorer dashboard.  This is only used during debugging.
+//In case CAN communication is lost, the bypass should be disabled after some time, 
+static bool safety_bypassEnabled(SafetyChecker* me, const SafetyInputs* in)
+{
+    return IO_RTC_GetTimeUS(me->timestamp_bypassSafetyChecks) < me->bypassSafetyChecksTimeout_us;
+}
+
+static bool safety_hvilOverrideEnabled(SafetyChecker* me, const SafetyInputs* in)
+{
+    return MCM_getHvilOverrideStatus(in->mcm) == TRUE;
+}
+
+// If HVIL term sense goes low (because HV went down), motor torque
+// command should be set to zero before turning off the controller
+static bool safety_hvilTermSenseLost(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->HVILTermSense->sensorValue == FALSE;
+}
+
+//100 ms averages, not single samples (see powerLimiter.h)
+static bool safety_over75kW_BMS(SafetyChecker* me, const SafetyInputs* in)
+{
+    return PowerLimiter_getBMSAverageW(in->power, POWER_WINDOW_SHORT) > 75000;
+}
+
+static bool safety_over75kW_MCM(SafetyChecker* me, const SafetyInputs* in)
+{
+    return PowerLimiter_getMCMAverageW(in->power, POWER_WINDOW_SHORT) > 75000;
+}
+
+//---------------------------------------------------------------------------
+// Table
+//---------------------------------------------------------------------------
+static const SafetyRule safetyRules[] = {
+    //set condition              clear condition               flag                   latch               set/clear ms  message
+    { safety_tpsNotCalibrated,    NULL,                         F_tpsNotCalibrated,    SAFETY_LATCH_NONE,  0,  0,   NULL },
+    { safety_bpsNotCalibrated,    NULL,                         F_bpsNotCalibrated,    SAFETY_LATCH_NONE,  0,  0,   NULL },
+    { safety_tpsPowerFailure,     NULL,                         F_tpsPowerFailure,     SAFETY_LATCH_NONE,  0,  0,   NULL },
+    //Only reported (F_tpsSignalFailure was never set) - make it a fault once TPS signal errors are understood
+    { safety_tpsSignalFailure,    NULL,                         N_tpsSignalFailure,    SAFETY_LATCH_NONE,  0,  0,   "TPS signal error\n" },
+    { safety_bpsPowerFailure,     NULL,                         F_bpsPowerFailure,     SAFETY_LATCH_NONE,  0,  0,   NULL },
+    { safety_bpsSignalFailure,    NULL,                         F_bpsSignalFailure,    SAFETY_LATCH_NONE,  0,  0,   NULL },
+    { safety_tpsOutOfRange,       NULL,                         F_tpsOutOfRange,       SAFETY_LATCH_NONE,  0,  0,   NULL },
+    { safety_bpsOutOfRange,       NULL,                         F_bpsOutOfRange,       SAFETY_LATCH_NONE,  0,  0,   NULL },
+    { safety_tpsOutOfSync,        NULL,                         F_tpsOutOfSync,        SAFETY_LATCH_NONE,  33, 100, "TPS discrepancy of over 10%\n" },
+    //(Only one BPS right now - F_bpsOutOfSync doesn't happen)
+    { safety_tpsbpsImplausible,   safety_tpsbpsPlausibleAgain,  F_tpsbpsImplausible,   SAFETY_LATCH_CLEAR, 33, 66,  "TPS BPS implausiblity detected.\n" },
+    { safety_lvsBatteryVeryLow,   NULL,                         F_lvsBatteryVeryLow,   SAFETY_LATCH_NONE,  0,  0,   "LVS battery EXTREMELY LOW!\n" },
+    { safety_lvsBatteryLow,       NULL,                         W_lvsBatteryLow,       SAFETY_LATCH_NONE,  0,  0,   "LVS battery LOW.\n" },
+    { safety_bypassEnabled,       NULL,                         W_safetyBypassEnabled, SAFETY_LATCH_NONE,  0,  0,   NULL },
+    { safety_hvilOverrideEnabled, NULL,                         W_hvilOverrideEnabled, SAFETY_LATCH_NONE,  0,  0,   NULL },
+    { safety_hvilTermSenseLost,   NULL,                         N_HVILTermSenseLost,   SAFETY_LATCH_NONE,  33, 0,   NULL },
+    { safety_over75kW_BMS,        NULL,                         N_Over75kW_BMS,        SAFETY_LATCH_NONE,  0,  0,   NULL },
+    { safety_over75kW_MCM,        NULL,                         N_Over75kW_MCM,        SAFETY_LATCH_NONE,  0,  0,   NULL },
+};
+#define SAFETY_RULE_COUNT (sizeof(safetyRules) / sizeof(safetyRules[0]))
+//Compile error (negative array size) if the table outgrows the per-rule arrays
+typedef char safetyRulesFit[(SAFETY_RULE_COUNT <= SAFETY_RULES_MAX) ? 1 : -1];
+
 /*****************************************************************************
 * Torque Encoder (TPS) functions
 * RULE EV2.3.5:
 * If an implausibility occurs between the values of these two sensors the power to the motor(s) must be immediately shut down completely.
 * It is not necessary to completely deactivate the tractive system, the motor controller(s) shutting down the power to the motor(s) is sufficient.
 ****************************************************************************/
-SafetyChecker* SafetyChecker_new(SerialManager* sm, ubyte2 maxChargeAmps, ubyte2 maxDischargeAmps)
+//Rounded down - with the first sample counted, a debounce never adds more than ms + one cycle
+static ubyte1 SafetyChecker_msToCycles(ubyte2 ms, ubyte4 cyclePeriodUs)
+{
+    ubyte4 cycles = (ubyte4)ms * 1000 / cyclePeriodUs;
+    return (cycles > 0xFE) ? 0xFE : (ubyte1)cycles;
+}
+
+SafetyChecker* SafetyChecker_new(SerialManager* sm, ubyte4 cyclePeriodUs, ubyte2 maxChargeAmps, ubyte2 maxDischargeAmps)
 {
-    SafetyChecker* me = (SafetyChecker*)malloc(sizeof(struct _SafetyChecker));
+    SafetyChecker* me = &safetyCheckerInstance;
 
     me->serialMan = sm;
-    me->faults = 0;
-    me->warnings = 0;
+    for (ubyte1 i = 0; i < 8; i++)
+    {
+        me->flags[i] = 0;
+    }
+    me->updateCount = 0;
 
-    me->tpsbpsImplausible = TRUE;
+    for (ubyte1 rule = 0; rule < SAFETY_RULE_COUNT; rule++)
+    {
+        me->setCycles[rule] = SafetyChecker_msToCycles(safetyRules[rule].setMs, cyclePeriodUs);
+        me->clearCycles[rule] = SafetyChecker_msToCycles(safetyRules[rule].clearMs, cyclePeriodUs);
+        me->pendingCycles[rule] = 0;
+        me->ruleMaxUs[rule] = 0;
+    }
+    me->evaluationMaxUs = 0;
 
     me->maxAmpsCharge = maxChargeAmps;
     me->maxAmpsDischarge = maxDischargeAmps;
@@ -132,343 +317,160 @@ void SafetyChecker_parseCanMessage(SafetyChecker* me, IO_CAN_DATA_FRAME* canMess
 	}
 }
 
-//Updates all values based on sensor readings, safety checks, etc
-void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, TorqueEncoder* tps, BrakePressureSensor* bps, Sensor* HVILTermSense, Sensor* LVBattery)
-{
-    ubyte1* message[50];  //For sprintf'ing variables to print in serial
-    //SerialManager_send(me->serialMan, "Entered SafetyChecker_update().\n");
-    /*****************************************************************************
-    * Faults
-    ****************************************************************************/
-	//===================================================================
-	// Get calibration status
-	//===================================================================
-    //me->faults = 0xFFFF; //Set ALL faults by default.  only clear if truly safe
-    me->faults &= ~F_unusedFaults;
-
-    //me->faults = 1;
-    if (tps->calibrated == FALSE) { me->faults |= F_tpsNotCalibrated; }
-    else { me->faults &= ~F_tpsNotCalibrated; }
-
-    if (bps->calibrated == FALSE) { me->faults |= F_bpsNotCalibrated; }
-    else { me->faults &= ~F_bpsNotCalibrated; }
-
-	//===================================================================
-	// Check if VCU was able to get a TPS/BPS reading
-	//===================================================================
-	if (tps->tps0->ioErr_powerInit != IO_E_OK
-		|| tps->tps1->ioErr_powerInit != IO_E_OK
-		|| tps->tps0->ioErr_powerSet != IO_E_OK
-		|| tps->tps1->ioErr_powerSet != IO_E_OK)
-    {
-        me->faults |= F_tpsPowerFailure;
-    }
-    else
-    {
-        me->faults &= ~F_tpsPowerFailure;
-    }
-
-	if (   tps->tps0->ioErr_signalInit != IO_E_OK
-		|| tps->tps1->ioErr_signalInit != IO_E_OK
-		|| tps->tps0->ioErr_signalGet != IO_E_OK
-		|| tps->tps1->ioErr_signalGet != IO_E_OK)
-	{
-		//me->faults |= F_tpsSignalFailure;
-        SerialManager_send(me->serialMan, "TPS signal error\n");
-	}
-    else
-    {
-        me->faults &= ~F_tpsSignalFailure;
-    }
-
-	if (bps->bps0->ioErr_powerInit != IO_E_OK
-		|| bps->bps0->ioErr_powerSet != IO_E_OK)
-	{
-		me->faults |= F_bpsPowerFailure;
-	}
-    else
-    {
-        me->faults &= ~F_bpsPowerFailure;
-    }
-
-	if (bps->bps0->ioErr_signalInit != IO_E_OK
-		|| bps->bps0->ioErr_signalGet != IO_E_OK)
-	{
-		me->faults |= F_bpsSignalFailure;
-	}
-    else
-    {
-        me->faults &= ~F_bpsSignalFailure;
-    }
-
-	//===================================================================
-	// Make sure raw sensor readings are within operating range
-	//===================================================================
-	//RULE: EV2.3.10 - signal outside of operating range is considered a failure
-	//  This refers to SPEC SHEET values, not calibration values
-	//Note: IC cars may continue to drive for up to 100ms until valid readings are restored, but EVs must immediately cut power
-	//Note: We need to decide how to report errors and how to perform actions when those errors occur.  For now, I'm calling an imaginary Err.Report function
-	
-	//-------------------------------------------------------------------
-	//Torque Encoder
-	//-------------------------------------------------------------------
-	if (tps->tps0->sensorValue < tps->tps0->specMin || tps->tps0->sensorValue > tps->tps0->specMax
-	||  tps->tps1->sensorValue < tps->tps1->specMin || tps->tps1->sensorValue > tps->tps1->specMax)
-	{
-		me->faults |= F_tpsOutOfRange;
-	}
-    else
-    {
-        me->faults &= ~F_tpsOutOfRange;
-    }
-
-	//-------------------------------------------------------------------
-	//Brake Pressure Sensor
-	//-------------------------------------------------------------------
-	if (bps->bps0->sensorValue < bps->bps0->specMin || bps->bps0->sensorValue > bps->bps0->specMax)
-	{
-		me->faults |= F_bpsOutOfRange;
-	}
-    else
-    {
-        me->faults &= ~F_bpsOutOfRange;
-    }
-
-	//===================================================================
-	// Make sure calibrated TPS readings are in sync with each other
-	//===================================================================
-	// EV2.3.5 If an implausibility occurs between the values of these two sensors
-	//  the power to the motor(s) must be immediately shut down completely. It is not necessary 
-	//  to completely deactivate the tractive system, the motor controller(s) shutting down the 
-	//  power to the motor(s) is sufficient.
-	// EV2.3.6 Implausibility is defined as a deviation of more than 10 % pedal travel between the sensors.
-	//-------------------------------------------------------------------
-	
-	//Check for implausibility (discrepancy > 10%)
-	//RULE: EV2.3.6 Implausibility is defined as a deviation of more than 10% pedal travel between the sensors.
-	float4 tps0Percent;   //Pedal percent float (a decimal between 0 and 1
-	float4 tps1Percent;
-
-	TorqueEncoder_getIndividualSensorPercent(tps, 0, &tps0Percent); //borrow the pedal percent variable
-	TorqueEncoder_getIndividualSensorPercent(tps, 1, &tps1Percent);
-
-    //sprintf(message, "TPS0: %f\n", tps0Percent);
-    //SerialManager_send(me->serialMan, message);
-    //sprintf(message, "TPS1: %f\n", tps1Percent);
-    //SerialManager_send(me->serialMan, message);
-
-	if ((tps1Percent - tps0Percent) > .1 || (tps1Percent - tps0Percent) < -.1)  //Note: Individual TPS readings don't go negative, otherwise this wouldn't work
-	{
-
-		//Err.Report(Err.Codes.TPSDiscrepancy, "TPS discrepancy of over 10%", Motor.Stop);
-        SerialManager_send(me->serialMan, "TPS discrepancy of over 10%\n");
-
-        me->faults |= F_tpsOutOfSync;
-	}
-    else
-    {
-        me->faults &= ~F_tpsOutOfSync;
-    }
+bool SafetyChecker_getFlag(SafetyChecker* me, SafetyFlag flag)
+{
+    return (me->flags[flag >> 3] & (1 << (flag & 7))) != 0;
+}
 
-    //Only one BPS right now - this fault doesn't happen
-    me->faults &= ~F_bpsOutOfSync;
-
-
-	//===================================================================
-	//Torque Encoder <-> Brake Pedal Plausibility Check
-	//===================================================================
-	// EV2.5 Torque Encoder / Brake Pedal Plausibility Check
-	//  The power to the motors must be immediately shut down completely, if the mechanical brakes 
-	//  are actuated and the torque encoder signals more than 25 % pedal travel at the same time.
-	//  This must be demonstrated when the motor controllers are under load.
-	// EV2.5.1 The motor power shut down must remain active until the torque encoder signals less than 5 % pedal travel,
-	//  no matter whether the brakes are still actuated or not.
-	//-------------------------------------------------------------------
-	//Implausibility if..
-    //float4 twelve = 12.0;
-    //SerialManager_sprintf(me->serialMan, "The number twelve: %d\n", &twelve);
-    bool tpsHigh = FALSE;
-    bool bpsHigh = FALSE;
-    if (bps->percent > .05) 
-    {
-        bpsHigh = TRUE;
-    }
-    else
+//Returns TRUE if the flag changed
+static bool SafetyChecker_setFlag(SafetyChecker* me, SafetyFlag flag, bool value)
+{
+    if (SafetyChecker_getFlag(me, flag) == value)
     {
-        bpsHigh = FALSE;
+        return FALSE;
     }
+    me->flags[flag >> 3] ^= (1 << (flag & 7));
+    return TRUE;
+}
 
-    if (tps->percent > .25) 
-    {
-        tpsHigh = TRUE;
-    }
-    else
-    {
-        tpsHigh = FALSE;
-    }
-    
-    
-    
-    //if (bps->percent > .05 && tps->percent > .25)
-    if (tpsHigh == TRUE && bpsHigh == TRUE)
+//Updates all values based on sensor readings, safety checks, etc
+void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, TorqueEncoder* tps, BrakePressureSensor* bps, Sensor* HVILTermSense, Sensor* LVBattery, PowerLimiter* power)
+{
+    SafetyInputs in;
+    const SafetyRule* rule;
+    bool changed = FALSE;
+    bool isSet;
+    bool wantChange;
+    ubyte4 timestamp_table;
+    ubyte4 timestamp_rule;
+    ubyte4 elapsed;
+
+    in.mcm = mcm;
+    in.bms = bms;
+    in.tps = tps;
+    in.bps = bps;
+    in.HVILTermSense = HVILTermSense;
+    in.LVBattery = LVBattery;
+    in.power = power;
+
+    IO_RTC_StartTime(&timestamp_table);
+    for (ubyte1 i = 0; i < SAFETY_RULE_COUNT; i++)
     {
-        //If mechanical brakes actuated && tps > 25%
-       
-            me->faults |= F_tpsbpsImplausible;
-            me->tpsbpsImplausible = TRUE;
-            SerialManager_send(me->serialMan, "TPS BPS implausiblity detected.\n");
-            //From here, assume that motor controller will check for implausibility before accepting commands
-       
-    }
-	//Clear implausibility if...
-	//if ((me->faults & F_tpsbpsImplausible) > 0)
-	//{
-		if (tps->percent < .10) //TPS is reduced to < 5%
-		{
-            //me->tpsbpsImplausible = FALSE;
-            //SerialManager_send(me->serialMan, "TPS below .05.  No implausibility.\n");
-			me->faults &= ~(F_tpsbpsImplausible);  //turn off the implausibility flag
-		}
-	//}
-
-        SerialManager_send(me->serialMan, "\n");
-
-
+        rule = &safetyRules[i];
+        IO_RTC_StartTime(&timestamp_rule);
 
+        isSet = SafetyChecker_getFlag(me, rule->flag);
+        if (isSet == FALSE)
+        {
+            wantChange = rule->set(me, &in);
+        }
+        else
+        {
+            wantChange = rule->set(me, &in) == FALSE
+                && (rule->latch == SAFETY_LATCH_NONE
+                    || (rule->latch == SAFETY_LATCH_CLEAR && rule->clear(me, &in) == TRUE));
+        }
 
-    /*****************************************************************************
-    * Warnings
-    ****************************************************************************/
-    //===================================================================
-    // LVS Battery Check - FAULTS LATCH UNTIL RETURN TO PREVIOUS STAGE
-    //===================================================================
-    //  IO_ADC_UBAT: 0..40106  (0V..40.106V)
-    //-------------------------------------------------------------------
-    if (LVBattery->sensorValue <= 9200)  //12730 = 10% SOC but hard to tell under load. 9200 = empty
-    {
-        me->faults |= F_lvsBatteryVeryLow;
-        me->warnings |= W_lvsBatteryLow;
-        sprintf(message, "LVS battery %.03fV EXTREMELY LOW!\n", (float4)LVBattery->sensorValue / 1000);
-        SerialManager_send(me->serialMan, message);
-    }
-    else if (LVBattery->sensorValue <= 12730)  //13100 = Recharge percentage, per Shorai
-    {
-        me->faults &= ~F_lvsBatteryVeryLow;
-        me->warnings |= W_lvsBatteryLow;
-        sprintf(message, "LVS battery %.03fV LOW.\n", (float4)LVBattery->sensorValue / 1000);
-        SerialManager_send(me->serialMan, message);
-    }
-    else
-    {
-        me->warnings &= ~F_lvsBatteryVeryLow;
-        me->warnings &= ~W_lvsBatteryLow;
-        //sprintf(message, "LVS battery %.03fV good.\n", (float4)LVBattery->sensorValue / 1000);
-    }
+        if (wantChange == FALSE)
+        {
+            me->pendingCycles[i] = 0;
+        }
+        else if (++me->pendingCycles[i] > ((isSet == FALSE) ? me->setCycles[i] : me->clearCycles[i]))
+        {
+            me->pendingCycles[i] = 0;
+            SafetyChecker_setFlag(me, rule->flag, (isSet == FALSE) ? TRUE : FALSE);
+            changed = TRUE;
+            if (isSet == FALSE && rule->message != NULL) { SerialManager_send(me->serialMan, rule->message); }
+        }
 
-    //===================================================================
-    // Safety checker bypass
-    //===================================================================
-    // The safety checker should only be bypassed by a CAN message sent by
-    // the PCAN Explorer dashboard.  This is only used during debugging.
-    //-------------------------------------------------------------------
-    //In case CAN communication is lost, the bypass should be disabled after some time, 
-    if (IO_RTC_GetTimeUS(me->timestamp_bypassSafetyChecks) < me->bypassSafetyChecksTimeout_us)
-    {
-        me->warnings |= W_safetyBypassEnabled;
-    }
-    else
-    {
-        me->warnings &= ~W_safetyBypassEnabled;
+        elapsed = IO_RTC_GetTimeUS(timestamp_rule);
+        if (elapsed > me->ruleMaxUs[i]) { me->ruleMaxUs[i] = (elapsed > 0xFFFF) ? 0xFFFF : (ubyte2)elapsed; }
     }
+    elapsed = IO_RTC_GetTimeUS(timestamp_table);
+    if (elapsed > me->evaluationMaxUs) { me->evaluationMaxUs = (elapsed > 0xFFFF) ? 0xFFFF : (ubyte2)elapsed; }
 
-    //===================================================================
-    // HVIL Override
-    //===================================================================
-    if (MCM_getHvilOverrideStatus(mcm) == TRUE)
+    if (changed == TRUE)
     {
-        me->warnings |= W_hvilOverrideEnabled;
-    }
-    else
-    {
-        me->warnings &= ~W_hvilOverrideEnabled;
+        me->updateCount++;
     }
+}
 
-	/*****************************************************************************
-	* Notices
-	****************************************************************************/
 
-    //===================================================================
-    // HVIL Term Sense Check
-    //===================================================================
-    // If HVIL term sense goes low (because HV went down), motor torque
-    // command should be set to zero before turning off the controller
-    //-------------------------------------------------------------------
-    if (HVILTermSense->sensorValue == FALSE)
-    {
-        me->notices |= N_HVILTermSenseLost;
-    }
-    else
-    {
-        me->notices &= ~N_HVILTermSenseLost;
-    }
+//Updates all values based on sensor readings, safety checks, etc
+bool SafetyChecker_allSafe(SafetyChecker* me)
+{
+    return (SafetyChecker_getFaults(me) == 0);
+}
 
+//Faults are flags 0-31
+ubyte4 SafetyChecker_getFaults(SafetyChecker* me)
+{
+    return (ubyte4)me->flags[0] | ((ubyte4)me->flags[1] << 8) | ((ubyte4)me->flags[2] << 16) | ((ubyte4)me->flags[3] << 24);
+}
 
-    if (BMS_getPower(bms) > 75000)
-    {
-        me->notices |= N_Over75kW_BMS;
-    }
-    else
-    {
-        me->notices &= ~N_Over75kW_BMS;
-    }
+//Warnings are flags 32-47
+ubyte4 SafetyChecker_getWarnings(SafetyChecker* me)
+{
+    return (ubyte4)me->flags[4] | ((ubyte4)me->flags[5] << 8);
+}
 
-        
-    if (MCM_getPower(mcm) > 75000)
-    {
-        me->notices |= N_Over75kW_MCM;
-    }
-    else
-    {
-        me->notices &= ~N_Over75kW_MCM;
-    }
+//Notices are flags 48-63
+ubyte4 SafetyChecker_getNotices(SafetyChecker* me)
+{
+    return (ubyte4)me->flags[6] | ((ubyte4)me->flags[7] << 8);
+}
 
+ubyte2 SafetyChecker_getUpdateCount(SafetyChecker* me)
+{
+    return (me->updateCount);
 }
 
+ubyte1 SafetyChecker_getRuleCount(SafetyChecker* me)
+{
+    return SAFETY_RULE_COUNT;
+}
 
-//Updates all values based on sensor readings, safety checks, etc
-bool SafetyChecker_allSafe(SafetyChecker* me)
+SafetyFlag SafetyChecker_getRuleFlag(SafetyChecker* me, ubyte1 rule)
 {
-    return (me->faults == 0);
+    return safetyRules[rule].flag;
 }
 
-//Updates all values based on sensor readings, safety checks, etc
-ubyte4 SafetyChecker_getFaults(SafetyChecker* me)
+ubyte2 SafetyChecker_getRuleMaxUs(SafetyChecker* me, ubyte1 rule)
 {
-    return (me->faults);
+    return me->ruleMaxUs[rule];
 }
 
-//Updates all values based on sensor readings, safety checks, etc
-ubyte4 SafetyChecker_getWarnings(SafetyChecker* me)
+ubyte2 SafetyChecker_getEvaluationMaxUs(SafetyChecker* me)
 {
-    return (me->warnings);
+    return me->evaluationMaxUs;
 }
 
-//Updates all values based on sensor readings, safety checks, etc
-ubyte4 SafetyChecker_getNotices(SafetyChecker* me)
+//Motor + inverter efficiency used to turn the BMS discharge power limit into shaft power
+#define DRIVE_EFFICIENCY_PERCENT 85
+//Below this the ceiling is calculated as if at this speed (avoids /0 - ceiling is huge there anyway)
+#define TORQUE_CEILING_MIN_RPM 100
+
+//Most torque (dNm) that can be made/absorbed with this much shaft power at this speed:
+//T[Nm] = P[W] * 60 / (2 pi rpm) = P * 9.5493 / rpm
+static sbyte4 SafetyChecker_torqueCeilingDNm(sbyte4 shaftPowerW, sbyte2 motorRPM)
 {
-    return (me->notices);
+    sbyte4 rpm = (motorRPM < 0) ? -motorRPM : motorRPM;
+    if (rpm < TORQUE_CEILING_MIN_RPM) { rpm = TORQUE_CEILING_MIN_RPM; }
+    if (shaftPowerW < 0) { shaftPowerW = 0; }
+    return shaftPowerW * 955 / (rpm * 10);
 }
 
-void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms)
+void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, ThermalDerating* thermal, PowerLimiter* power, WheelSpeeds* wss)
 {
     float4 multiplier = 1;
     //float4 tempMultiplier = 1;
-    sbyte1 groundSpeedKPH = MCM_getGroundSpeedKPH(mcm);
 
     //-------------------------------------------------------------------
     // Critical conditions - set 0 torque
     //-------------------------------------------------------------------
-    if (me->faults > 0) //Any VCU fault exists
+    //The safety bypass (debug, 0xC4 on 0x5FF) only skips this - every limit below still applies
+    if (SafetyChecker_allSafe(me) == FALSE //Any VCU fault exists
+        && SafetyChecker_getFlag(me, W_safetyBypassEnabled) == FALSE)
     {
         multiplier = 0;
     }
@@ -487,6 +489,12 @@ void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, Battery
     // IMPORTANT: Be aware of direction-sensitive situations (accel/regen)
     //-------------------------------------------------------------------
     //80kW limit ---------------------------------
+    //Closed loop on the 100/500 ms averages (see powerLimiter.h).  Discharge only.
+    if (MCM_commands_getTorque(mcm) > 0 && PowerLimiter_getMultiplier(power) < multiplier)
+    {
+        multiplier = PowerLimiter_getMultiplier(power);
+    }
+    //Old open-loop version:
     // if either the bms or mcm goes over 75kw, limit torque 
     //////////if ((BMS_getPower(bms) > 75000) || (MCM_getPower(mcm) > 75000))
     //////////{
@@ -512,38 +520,37 @@ void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, Battery
     //11 = B : Power up delay(Charge testing)
     //12 = C : Fault
     //13 = D : Contactors are off
-    ////////if (MCM_commands/*_getTorque(mcm) >= 0)
-    ////////{*/
-        ///////////*tempMultiplier = getPercent(BMS_getDCL(bms), 0, me->maxAmpsDischarge, TRUE);
-        //////////if (tempMultiplier < 1)
-        //////////{
-        //////////    SerialManager_send(me->serialMan, "SC.Mult: DCL\n");
-        //////////}*/
-    //////////}
-    //////////else //regen - Pick the lowest of CCL and speed reductions
-    //////////{
-    //////////    tempMultiplier = getPercent(BMS_getCCL(bms), 0, me->maxAmpsCharge, TRUE);
-    //////////    if (tempMultiplier < 1)
-    //////////    {
-    //////////        SerialManager_send(me->serialMan, "SC.Mult: CCL\n");
-    //////////    }
-    //////////    //Also, regen should be ramped down as speed approaches minimum
-    //////////    if ( groundSpeedKPH < 15)
-    //////////    {
-    //////////        float4 regenMultiplier = 1 - getPercent(groundSpeedKPH, MCM_getRegenMinSpeed(mcm), MCM_getRegenRampdownStartSpeed(mcm), TRUE);
-    //////////        if (tempMultiplier < 1) { SerialManager_send(me->serialMan, "SC.Mult: Regen < 15kph\n"); }
-    //////////        if (regenMultiplier < tempMultiplier) { tempMultiplier = regenMultiplier; } // Pick the lesser of CCL (tempMultiplier) or speed reduction (regenMultiplier)
-    //////////    }
-    //////////}
-    ////////if (tempMultiplier < multiplier) { multiplier = tempMultiplier; }
+    //DCL (accel) / CCL (regen) converted to a torque ceiling at the current motor speed
+    if (BMS_getCurrentLimitsReceived(bms) == TRUE)
+    {
+        sbyte2 torque = MCM_commands_getTorque(mcm);
+        sbyte2 torqueMagnitude = (torque < 0) ? -torque : torque;
+        sbyte4 ceilingDNm = (torque >= 0)
+            ? SafetyChecker_torqueCeilingDNm(BMS_getDischargePowerLimitW(bms) * DRIVE_EFFICIENCY_PERCENT / 100, MCM_getMotorRPM(mcm))
+            : SafetyChecker_torqueCeilingDNm(BMS_getChargePowerLimitW(bms), MCM_getMotorRPM(mcm));
 
-    //Reduce the torque command.  Multiplier should be a percent value (between 0 and 1)
+        if (torqueMagnitude > ceilingDNm)
+        {
+            float4 limitMultiplier = (float4)ceilingDNm / torqueMagnitude;
+            if (limitMultiplier < multiplier) { multiplier = limitMultiplier; }
+        }
+    }
+    //Regen speed rampdown --------------------------------
+    //Full regen above RampdownStartSpeed, none below MinSpeed, smoothstep in between
+    //(no corner at either end, so the driver doesn't feel regen switch on/off)
+    if (MCM_commands_getTorque(mcm) < 0)
+    {
+        float4 speedKPH = WheelSpeeds_getFusedGroundSpeedKPH(wss, MCM_getGroundSpeedKPH(mcm));
+        float4 x = getPercent(speedKPH, MCM_getRegenMinSpeed(mcm), MCM_getRegenRampdownStartSpeed(mcm), TRUE);
+        float4 regenMultiplier = x * x * (3 - 2 * x);
+        if (regenMultiplier < multiplier) { multiplier = regenMultiplier; }
+    }
 
-	//If the safety bypass is enabled, then override the multiplier to 100% (no reduction)
-    if ((me->warnings & W_safetyBypassEnabled) == W_safetyBypassEnabled)
-	{
-		multiplier = 1;
-	}
+    //Thermal derating (motor / inverter / battery temps) --------------
+    //Applies to regen too - it heats the same parts
+    if (ThermalDerating_getMultiplier(thermal) < multiplier) { multiplier = ThermalDerating_getMultiplier(thermal); }
+
+    //Reduce the torque command.  Multiplier should be a percent value (between 0 and 1)
     MCM_commands_setTorqueDNm(mcm, MCM_commands_getTorque(mcm) * multiplier);
 }
 
@@ -9,6 +9,9 @@
 #include "motorController.h"
 #include "bms.h"
 #include "serial.h"
+#include "thermalDerating.h"
+#include "powerLimiter.h"
+#include "wheelSpeeds.h"
 
 /*
 typedef enum { CHECK_tpsOutOfRange    , CHECK_bpsOutOfRange
@@ -18,16 +21,55 @@ typedef enum { CHECK_tpsOutOfRange    , CHECK_bpsOutOfRange
 			 } SafetyCheck;
 */
 
+//One bit each in a 64-flag set.  Faults zero torque, warnings and notices are
+//informational.  The numbers are bit positions on CAN (0x506 = the whole set,
+//bytes 0-3 faults, 4-5 warnings, 6-7 notices), so don't renumber them.
+typedef enum
+{
+    //Faults (0-31)
+      F_tpsOutOfRange = 0
+    , F_bpsOutOfRange = 1
+    , F_tpsPowerFailure = 2
+    , F_bpsPowerFailure = 3
+    , F_tpsSignalFailure = 4   //NOT USED (see N_tpsSignalFailure)
+    , F_bpsSignalFailure = 5
+    , F_tpsNotCalibrated = 6
+    , F_bpsNotCalibrated = 7
+    , F_tpsOutOfSync = 8
+    , F_bpsOutOfSync = 9       //NOT USED
+    , F_tpsbpsImplausible = 10
+    , F_lvsBatteryVeryLow = 16
+
+    //Warnings (32-47)
+    , W_lvsBatteryLow = 32
+    , W_hvilOverrideEnabled = 38  //This flag indicates HVIL bypass (MCM turn on)
+    , W_safetyBypassEnabled = 39  //This flag controls the safety bypass
+
+    //Notices (48-63)
+    , N_HVILTermSenseLost = 48
+    , N_tpsSignalFailure = 49
+    , N_Over75kW_BMS = 52
+    , N_Over75kW_MCM = 53
+} SafetyFlag;
+
 typedef struct _SafetyChecker SafetyChecker;
 
-SafetyChecker* SafetyChecker_new(SerialManager* sm, ubyte2 maxChargeAmps, ubyte2 maxDischargeAmps);
-void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, TorqueEncoder* tps, BrakePressureSensor* bps, Sensor* HVILTermSense, Sensor* LVBattery);
+SafetyChecker* SafetyChecker_new(SerialManager* sm, ubyte4 cyclePeriodUs, ubyte2 maxChargeAmps, ubyte2 maxDischargeAmps);
+void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, TorqueEncoder* tps, BrakePressureSensor* bps, Sensor* HVILTermSense, Sensor* LVBattery, PowerLimiter* power);
 void SafetyChecker_parseCanMessage(SafetyChecker* me, IO_CAN_DATA_FRAME* canMessage);
 bool SafetyChecker_allSafe(SafetyChecker* me);
 ubyte4 SafetyChecker_getFaults(SafetyChecker* me);
 ubyte4 SafetyChecker_getWarnings(SafetyChecker* me);
 ubyte4 SafetyChecker_getNotices(SafetyChecker* me);
-void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms);
+ubyte2 SafetyChecker_getUpdateCount(SafetyChecker* me);
+bool SafetyChecker_getFlag(SafetyChecker* me, SafetyFlag flag);
+
+//Rule table profiling: slowest evaluation seen, per rule and for the whole table
+ubyte1 SafetyChecker_getRuleCount(SafetyChecker* me);
+SafetyFlag SafetyChecker_getRuleFlag(SafetyChecker* me, ubyte1 rule);
+ubyte2 SafetyChecker_getRuleMaxUs(SafetyChecker* me, ubyte1 rule);
+ubyte2 SafetyChecker_getEvaluationMaxUs(SafetyChecker* me);
+void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, ThermalDerating* thermal, PowerLimiter* power, WheelSpeeds* wss);
 //bool SafetyChecker_getError(SafetyChecker* me, SafetyCheck check);
 //bool SafetyChecker_getErrorByte(SafetyChecker* me, ubyte1* errorByte);
 
@@ -17,6 +17,7 @@
 #include "IO_PWD.h"
 #include "IO_PWM.h"
 #include "IO_DIO.h"
+#include "IO_RTC.h"
 
 #include "sensors.h"
 #include "mathFunctions.h"
@@ -51,58 +52,108 @@ extern Sensor Sensor_HVILTerminationSense;
 * Returns the % (position) of value, between min and max
 * If zeroToOneOnly is true, then % will be capped at 0%-100% (no negative % or > 100%)
 -------------------------------------------------------------------*/
+//----------------------------------------------------------------------------
+// Sensor registry
+//----------------------------------------------------------------------------
+// One entry per sensor that sensors_updateSensors() reads.  ioChannel is the
+// IO driver channel, samplePeriod_us is how often the channel is read (see
+// SENSOR_PERIOD_x in sensors.h).  timestamp_lastSample starts at 0 so every
+// sensor is read on the first cycle.
+//----------------------------------------------------------------------------
+typedef struct _SensorChannel
+{
+    Sensor* sensor;
+    SensorInputType inputType;
+    ubyte1 ioChannel;
+    ubyte4 samplePeriod_us;
+    ubyte4 timestamp_lastSample;
+} SensorChannel;
+
+static SensorChannel sensorChannels[] =
+{
+    //Torque Encoders / Brake Position Sensor ---------------------------
+    //(Production TPS may move to IO_PWD_PulseGet on IO_PWM_00/01 in the future)
+      { &Sensor_TPS0,                 SENSOR_INPUT_ADC,      IO_ADC_5V_00, SENSOR_PERIOD_FAST,  0 }
+    , { &Sensor_TPS1,                 SENSOR_INPUT_ADC,      IO_ADC_5V_01, SENSOR_PERIOD_FAST,  0 }
+    , { &Sensor_BPS0,                 SENSOR_INPUT_ADC,      IO_ADC_5V_02, SENSOR_PERIOD_FAST,  0 }
+
+    //Wheel speed sensors -----------------------------------------------
+    , { &Sensor_WSS_FL,               SENSOR_INPUT_PWD_FREQ, IO_PWD_10,    SENSOR_PERIOD_FAST,  0 } //IO_PIN_274
+    , { &Sensor_WSS_FR,               SENSOR_INPUT_PWD_FREQ, IO_PWD_08,    SENSOR_PERIOD_FAST,  0 } //IO_PIN_275
+    , { &Sensor_WSS_RL,               SENSOR_INPUT_PWD_FREQ, IO_PWD_11,    SENSOR_PERIOD_FAST,  0 } //IO_PIN_267
+    , { &Sensor_WSS_RR,               SENSOR_INPUT_PWD_FREQ, IO_PWD_09,    SENSOR_PERIOD_FAST,  0 } //IO_PIN_268 //Rear right WSS dead, confirmed by Brian A. w/ oscilloscope on May 5, 2018
+
+    //Shock pots - sampled every cycle (~30 Hz) for chassis DAQ ---------
+    //(FL and the steering angle sensor have no confirmed pin yet - see vcu_initializeADC)
+    , { &Sensor_WPS_FR,               SENSOR_INPUT_ADC,      IO_ADC_5V_05, SENSOR_PERIOD_FAST,  0 }
+    , { &Sensor_WPS_RL,               SENSOR_INPUT_ADC,      IO_ADC_5V_06, SENSOR_PERIOD_FAST,  0 }
+    , { &Sensor_WPS_RR,               SENSOR_INPUT_ADC,      IO_ADC_5V_07, SENSOR_PERIOD_FAST,  0 }
+
+    //HVIL term sense stays fast - MCM relay shutdown depends on it -----
+    , { &Sensor_HVILTerminationSense, SENSOR_INPUT_DI,       IO_DI_07,     SENSOR_PERIOD_FAST,  0 } //IO_PIN_253
+
+    //Dash controls -----------------------------------------------------
+    , { &Sensor_TCSKnob,              SENSOR_INPUT_ADC,      IO_ADC_5V_04, SENSOR_PERIOD_20MS,  0 }
+    , { &Sensor_RTDButton,            SENSOR_INPUT_DI,       IO_DI_00,     SENSOR_PERIOD_20MS,  0 } //IO_PIN_263
+    , { &Sensor_EcoButton,            SENSOR_INPUT_DI,       IO_DI_01,     SENSOR_PERIOD_20MS,  0 } //IO_PIN_256
+    , { &Sensor_TCSSwitchUp,          SENSOR_INPUT_DI,       IO_DI_02,     SENSOR_PERIOD_20MS,  0 } //IO_PIN_262
+    , { &Sensor_TCSSwitchDown,        SENSOR_INPUT_DI,       IO_DI_03,     SENSOR_PERIOD_20MS,  0 } //IO_PIN_255
+
+    //Battery voltage (at VCU internal electronics supply input) --------
+    , { &Sensor_LVBattery,            SENSOR_INPUT_ADC,      IO_ADC_UBAT,  SENSOR_PERIOD_100MS, 0 }
+};
+
+static const ubyte1 sensorChannelCount = sizeof(sensorChannels) / sizeof(sensorChannels[0]);
+
 //----------------------------------------------------------------------------
 // Read sensors values from ADC channels
 // The sensor values should be stored in sensor objects.
+// Only channels whose sample period has elapsed are read; everything else
+// keeps its last value.
 //----------------------------------------------------------------------------
 void sensors_updateSensors(void)
 {
     //TODO: Handle errors (using the return values for these Get functions)
+    SensorChannel* channel;
+    ubyte4 lastValue;
 
-    //TODO: RTDS
-
-    //Torque Encoders ---------------------------------------------------
-    //Sensor_BenchTPS0.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_00, &Sensor_BenchTPS0.sensorValue, &Sensor_BenchTPS0.fresh);
-    //Sensor_BenchTPS1.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_01, &Sensor_BenchTPS1.sensorValue, &Sensor_BenchTPS1.fresh);
-    Sensor_TPS0.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_00, &Sensor_TPS0.sensorValue, &Sensor_TPS0.fresh);
-    Sensor_TPS1.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_01, &Sensor_TPS1.sensorValue, &Sensor_TPS1.fresh);
-    //Sensor_TPS0.ioErr_signalGet = IO_PWD_PulseGet(IO_PWM_00, &Sensor_TPS0.sensorValue);
-	//Sensor_TPS1.ioErr_signalGet = IO_PWD_PulseGet(IO_PWM_01, &Sensor_TPS1.sensorValue);
-
-	
-	//Brake Position Sensor ---------------------------------------------------
-	Sensor_BPS0.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_02, &Sensor_BPS0.sensorValue, &Sensor_BPS0.fresh);
-
-	//TCS Knob
-	Sensor_TCSKnob.ioErr_signalGet = IO_ADC_Get(IO_ADC_5V_04, &Sensor_TCSKnob.sensorValue, &Sensor_TCSKnob.fresh);
-    
-	//?? - For future use ---------------------------------------------------
-    //IO_ADC_Get(IO_ADC_5V_03, &Sensor_BPS1.sensorValue, &Sensor_BPS1.fresh);
-
-    //Shock pots ---------------------------------------------------
-    /*IO_ADC_Get(IO_ADC_5V_04, &Sensor_WPS_FL.sensorValue, &Sensor_WPS_FL.fresh);
-    IO_ADC_Get(IO_ADC_5V_05, &Sensor_WPS_FR.sensorValue, &Sensor_WPS_FR.fresh);
-    IO_ADC_Get(IO_ADC_5V_06, &Sensor_WPS_RL.sensorValue, &Sensor_WPS_RL.fresh);
-    IO_ADC_Get(IO_ADC_5V_07, &Sensor_WPS_RR.sensorValue, &Sensor_WPS_RR.fresh);
-	*/
-
-    //Wheel speed sensors ---------------------------------------------------
-	Sensor_WSS_FL.ioErr_signalGet = IO_PWD_FreqGet(IO_PWD_10, &Sensor_WSS_FL.sensorValue); //IO_PIN_274
-	Sensor_WSS_FR.ioErr_signalGet = IO_PWD_FreqGet(IO_PWD_08, &Sensor_WSS_FR.sensorValue); //IO_PIN_275
-	Sensor_WSS_RL.ioErr_signalGet = IO_PWD_FreqGet(IO_PWD_11, &Sensor_WSS_RL.sensorValue); //IO_PIN_267
-	Sensor_WSS_RR.ioErr_signalGet = IO_PWD_FreqGet(IO_PWD_09, &Sensor_WSS_RR.sensorValue); //IO_PIN_268 //Rear right WSS dead, confirmed by Brian A. w/ oscilloscope on May 5, 2018
-
-    //Switches / Digital ---------------------------------------------------
-	Sensor_RTDButton.ioErr_signalGet = IO_DI_Get(IO_DI_00, &Sensor_RTDButton.sensorValue); //IO_PIN_263
-	Sensor_EcoButton.ioErr_signalGet = IO_DI_Get(IO_DI_01, &Sensor_EcoButton.sensorValue); //IO_PIN_256
-	Sensor_TCSSwitchUp.ioErr_signalGet = IO_DI_Get(IO_DI_02, &Sensor_TCSSwitchUp.sensorValue); //IO_PIN_262
-	Sensor_TCSSwitchDown.ioErr_signalGet = IO_DI_Get(IO_DI_03, &Sensor_TCSSwitchDown.sensorValue); //IO_PIN_255
-	Sensor_HVILTerminationSense.ioErr_signalGet = IO_DI_Get(IO_DI_07, &Sensor_HVILTerminationSense.sensorValue); //IO_PIN_253
-
-    //Other stuff ---------------------------------------------------
-    //Battery voltage (at VCU internal electronics supply input)
-	Sensor_LVBattery.ioErr_signalGet = IO_ADC_Get(IO_ADC_UBAT, &Sensor_LVBattery.sensorValue, &Sensor_LVBattery.fresh);
-
+    for (ubyte1 i = 0; i < sensorChannelCount; i++)
+    {
+        channel = &sensorChannels[i];
+
+        //Skip the IO driver entirely if this sensor isn't due yet
+        if (channel->samplePeriod_us != SENSOR_PERIOD_FAST
+            && IO_RTC_GetTimeUS(channel->timestamp_lastSample) < channel->samplePeriod_us)
+        {
+            continue;
+        }
+
+        lastValue = channel->sensor->sensorValue;
+        switch (channel->inputType)
+        {
+        case SENSOR_INPUT_ADC:
+            channel->sensor->ioErr_signalGet = IO_ADC_Get(channel->ioChannel, &channel->sensor->sensorValue, &channel->sensor->fresh);
+            break;
+
+        case SENSOR_INPUT_PWD_FREQ:
+            channel->sensor->ioErr_signalGet = IO_PWD_FreqGet(channel->ioChannel, &channel->sensor->sensorValue);
+            break;
+
+        case SENSOR_INPUT_DI:
+            channel->sensor->ioErr_signalGet = IO_DI_Get(channel->ioChannel, &channel->sensor->sensorValue);
+            break;
+        }
+
+        if (channel->sensor->sensorValue != lastValue)
+        {
+            channel->sensor->updateCount++;
+        }
+
+        if (channel->samplePeriod_us != SENSOR_PERIOD_FAST)
+        {
+            IO_RTC_StartTime(&channel->timestamp_lastSample);
+        }
+    }
 
 }
 
@@ -135,6 +135,7 @@ typedef struct _Sensor {
     //ubyte2 calibratedValue;
     ubyte4 sensorValue;
     bool fresh;
+    ubyte2 updateCount;  //Incremented by sensors_updateSensors() whenever sensorValue changes
     //bool isCalibrated;
 	IO_ErrorType ioErr_powerInit;
 	IO_ErrorType ioErr_powerSet;
@@ -188,6 +189,20 @@ extern Sensor Sensor_HVILTerminationSense;
 extern Sensor Sensor_LVBattery; // = { 0xA };  //Note: There will be no init for this "sensor"
 
 
+//----------------------------------------------------------------------------
+// Sensor sampling rates
+//----------------------------------------------------------------------------
+// Every sensor registered in sensors.c declares how often it should be read
+// from the IO driver.  sensors_updateSensors() only touches the channels that
+// are due, so slow signals (knob, buttons, LV battery) don't eat into the
+// fast control loop.  A period of 0 means the sensor is read every cycle.
+//----------------------------------------------------------------------------
+#define SENSOR_PERIOD_FAST      0       //Every main loop cycle (pedals, wheel speeds, HVIL)
+#define SENSOR_PERIOD_20MS      20000   //Dash knob and buttons
+#define SENSOR_PERIOD_100MS     100000  //LV battery
+
+typedef enum { SENSOR_INPUT_ADC, SENSOR_INPUT_PWD_FREQ, SENSOR_INPUT_DI } SensorInputType;
+
 //----------------------------------------------------------------------------
 // Sensor Functions
 //----------------------------------------------------------------------------
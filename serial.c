@@ -1,4 +1,3 @@
-#include <stdlib.h>  //Needed for malloc
 #include <stdio.h>  //sprintf
 #include <string.h>
 #include "IO_Driver.h"
@@ -15,9 +14,11 @@ struct _SerialManager {
     ubyte1 size;  //This value is thrown away
 };
 
+static struct _SerialManager serialManagerInstance;
+
 SerialManager* SerialManager_new(void)
 {
-    SerialManager* me = (SerialManager*)malloc(sizeof(struct _SerialManager));
+    SerialManager* me = &serialManagerInstance;
     IO_UART_Init(IO_UART_RS232, 115200, 8, IO_UART_PARITY_NONE, 1);
 
     return me;
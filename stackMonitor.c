@@ -0,0 +1,65 @@
+#include "IO_Driver.h"
+
+#include "stackMonitor.h"
+
+//Pattern written into unused stack
+#define STACK_MONITOR_PAINT 0xA5
+
+//Bytes right below StackMonitor_new's marker that are left alone (this function's own frame)
+#define STACK_MONITOR_GUARD 32
+
+struct _StackMonitor
+{
+    volatile ubyte1* paintBottom;  //Lowest painted address (stack grows down toward this)
+    ubyte2 paintedBytes;
+    ubyte2 highWaterBytes;
+};
+
+static struct _StackMonitor stackMonitorInstance;
+
+StackMonitor* StackMonitor_new(ubyte2 bytesToPaint)
+{
+    volatile ubyte1 marker = 0;  //Approximately main()'s stack pointer
+    StackMonitor* me = &stackMonitorInstance;
+
+    me->paintedBytes = bytesToPaint;
+    me->paintBottom = &marker - STACK_MONITOR_GUARD - bytesToPaint;
+    me->highWaterBytes = STACK_MONITOR_GUARD;
+
+    for (ubyte2 i = 0; i < bytesToPaint; i++)
+    {
+        me->paintBottom[i] = STACK_MONITOR_PAINT;
+    }
+
+    return me;
+}
+
+//Scan up from the bottom of the painted area to the first byte that was overwritten.
+//Only the part below the current high-water mark has to be checked.
+void StackMonitor_update(StackMonitor* me)
+{
+    ubyte2 untouched = 0;
+    ubyte2 limit = me->paintedBytes + STACK_MONITOR_GUARD - me->highWaterBytes;
+
+    while (untouched < limit && me->paintBottom[untouched] == STACK_MONITOR_PAINT)
+    {
+        untouched++;
+    }
+
+    me->highWaterBytes = me->paintedBytes + STACK_MONITOR_GUARD - untouched;
+}
+
+ubyte2 StackMonitor_getHighWaterBytes(StackMonitor* me)
+{
+    return me->highWaterBytes;
+}
+
+ubyte2 StackMonitor_getPaintedBytes(StackMonitor* me)
+{
+    return me->paintedBytes;
+}
+
+bool StackMonitor_getOverflow(StackMonitor* me)
+{
+    return (me->paintBottom[0] != STACK_MONITOR_PAINT);
+}
@@ -0,0 +1,27 @@
+#ifndef _STACKMONITOR_H
+#define _STACKMONITOR_H
+
+#include "IO_Driver.h"
+
+/*****************************************************************************
+* Stack Monitor
+******************************************************************************
+* Paints a block of (unused) stack below main()'s frame with a known pattern
+* at startup.  Whatever gets overwritten has been used by something called
+* from main, so the deepest overwritten byte = worst-case stack depth so far.
+*
+* StackMonitor_new MUST be the first thing main() calls (before
+* IO_Driver_Init enables interrupts), and bytesToPaint must fit inside the
+* stack reserved in the linker script.
+****************************************************************************/
+
+typedef struct _StackMonitor StackMonitor;
+
+StackMonitor* StackMonitor_new(ubyte2 bytesToPaint);
+void StackMonitor_update(StackMonitor* me);
+
+ubyte2 StackMonitor_getHighWaterBytes(StackMonitor* me);  //Deepest stack use seen (bytes below main)
+ubyte2 StackMonitor_getPaintedBytes(StackMonitor* me);
+bool StackMonitor_getOverflow(StackMonitor* me);  //The whole painted area was used - real depth is unknown
+
+#endif //  _STACKMONITOR_H
@@ -0,0 +1,138 @@
+#include "IO_Driver.h"
+
+#include "thermalDerating.h"
+#include "motorController.h"
+#include "bms.h"
+
+//One point on a derating curve.  Between points the % is interpolated,
+//below the first point it's the first %, above the last it's the last %.
+typedef struct
+{
+    sbyte2 tempC;
+    ubyte1 percent;
+} ThermalPoint;
+
+//Emrax 228: 120 C winding limit
+static const ThermalPoint motorCurve[] = { { 100, 100 }, { 110, 60 }, { 120, 0 } };
+//RMS PM100 power modules (inverter derates/faults itself above ~105 C)
+static const ThermalPoint inverterCurve[] = { { 85, 100 }, { 95, 50 }, { 105, 0 } };
+//Cells: 60 C max discharge temp
+static const ThermalPoint batteryCurve[] = { { 50, 100 }, { 55, 50 }, { 60, 0 } };
+
+#define CURVE_POINTS(curve) (sizeof(curve) / sizeof(curve[0]))
+
+struct _ThermalDerating
+{
+    ubyte2 lastMotorTempCount;
+    ubyte2 lastModuleTempCount;
+    ubyte2 lastBmsTempCount;
+
+    ubyte1 percent[4];  //Indexed by ThermalSource (NONE = overall)
+    ThermalSource limitingSource;
+    ubyte2 updateCount;
+};
+
+static struct _ThermalDerating thermalDeratingInstance;
+
+ThermalDerating* ThermalDerating_new(void)
+{
+    ThermalDerating* me = &thermalDeratingInstance;
+
+    me->lastMotorTempCount = 0;
+    me->lastModuleTempCount = 0;
+    me->lastBmsTempCount = 0;
+    for (ubyte1 source = 0; source < 4; source++)
+    {
+        me->percent[source] = 100;
+    }
+    me->limitingSource = THERMAL_SOURCE_NONE;
+    me->updateCount = 0;
+
+    return me;
+}
+
+static ubyte1 ThermalDerating_lookup(const ThermalPoint* curve, ubyte1 points, sbyte2 tempC)
+{
+    if (tempC <= curve[0].tempC)
+    {
+        return curve[0].percent;
+    }
+
+    for (ubyte1 i = 1; i < points; i++)
+    {
+        if (tempC < curve[i].tempC)
+        {
+            //Linear between point i-1 and point i
+            sbyte2 span = curve[i].tempC - curve[i - 1].tempC;
+            sbyte2 into = tempC - curve[i - 1].tempC;
+            return curve[i - 1].percent - (sbyte2)((curve[i - 1].percent - curve[i].percent) * into / span);
+        }
+    }
+    return curve[points - 1].percent;
+}
+
+void ThermalDerating_update(ThermalDerating* me, MotorController* mcm, BatteryManagementSystem* bms)
+{
+    bool changed = FALSE;
+
+    //Motor (0xA2) and inverter (0xA0) temps come in separate messages, and the
+    //MCM's temps start as 99 C placeholders - only use each one once its own
+    //message has arrived
+    if (MCM_getMotorTempUpdateCount(mcm) != me->lastMotorTempCount)
+    {
+        me->lastMotorTempCount = MCM_getMotorTempUpdateCount(mcm);
+        me->percent[THERMAL_SOURCE_MOTOR] = ThermalDerating_lookup(motorCurve, CURVE_POINTS(motorCurve), MCM_getMotorTemp(mcm));
+        changed = TRUE;
+    }
+
+    if (MCM_getModuleTempUpdateCount(mcm) != me->lastModuleTempCount)
+    {
+        me->lastModuleTempCount = MCM_getModuleTempUpdateCount(mcm);
+        me->percent[THERMAL_SOURCE_INVERTER] = ThermalDerating_lookup(inverterCurve, CURVE_POINTS(inverterCurve), MCM_getTemp(mcm));
+        changed = TRUE;
+    }
+
+    if (BMS_getTempUpdateCount(bms) != me->lastBmsTempCount)
+    {
+        me->lastBmsTempCount = BMS_getTempUpdateCount(bms);
+        me->percent[THERMAL_SOURCE_BATTERY] = ThermalDerating_lookup(batteryCurve, CURVE_POINTS(batteryCurve), BMS_getMaxTemp(bms));
+        changed = TRUE;
+    }
+
+    if (changed == FALSE)
+    {
+        return;
+    }
+
+    me->percent[THERMAL_SOURCE_NONE] = 100;
+    me->limitingSource = THERMAL_SOURCE_NONE;
+    for (ubyte1 source = THERMAL_SOURCE_MOTOR; source <= THERMAL_SOURCE_BATTERY; source++)
+    {
+        if (me->percent[source] < me->percent[THERMAL_SOURCE_NONE])
+        {
+            me->percent[THERMAL_SOURCE_NONE] = me->percent[source];
+            me->limitingSource = source;
+        }
+    }
+    me->updateCount++;
+}
+
+float4 ThermalDerating_getMultiplier(ThermalDerating* me)
+{
+    return me->percent[THERMAL_SOURCE_NONE] / 100.0;
+}
+
+ubyte1 ThermalDerating_getPercent(ThermalDerating* me, ThermalSource source)
+{
+    return me->percent[source];
+}
+
+ThermalSource ThermalDerating_getLimitingSource(ThermalDerating* me)
+{
+    return me->limitingSource;
+}
+
+ubyte2 ThermalDerating_getUpdateCount(ThermalDerating* me)
+{
+    return me->updateCount;
+}
@@ -0,0 +1,41 @@
+#ifndef _THERMALDERATING_H
+#define _THERMALDERATING_H
+
+#include "IO_Driver.h"
+#include "motorController.h"
+#include "bms.h"
+
+/*****************************************************************************
+* Thermal Derating
+******************************************************************************
+* Scales torque down as the motor, inverter (hottest power module) or battery
+* (hottest cell) get close to their limits, so the car finishes endurance
+* slower instead of tripping a fault.  Each source has its own small
+* temperature -> % curve (see thermalDerating.c); the torque multiplier is
+* the lowest of the three.
+*
+* A source's curve is only re-evaluated when a new temperature for it has
+* arrived over CAN.  Until the first one arrives a source doesn't derate.
+****************************************************************************/
+
+typedef enum
+{
+      THERMAL_SOURCE_NONE
+    , THERMAL_SOURCE_MOTOR
+    , THERMAL_SOURCE_INVERTER
+    , THERMAL_SOURCE_BATTERY
+} ThermalSource;
+
+typedef struct _ThermalDerating ThermalDerating;
+
+ThermalDerating* ThermalDerating_new(void);
+
+//Call once per cycle after CanManager_read
+void ThermalDerating_update(ThermalDerating* me, MotorController* mcm, BatteryManagementSystem* bms);
+
+float4 ThermalDerating_getMultiplier(ThermalDerating* me);  //0 to 1
+ubyte1 ThermalDerating_getPercent(ThermalDerating* me, ThermalSource source);  //NONE = overall
+ThermalSource ThermalDerating_getLimitingSource(ThermalDerating* me);
+ubyte2 ThermalDerating_getUpdateCount(ThermalDerating* me);
+
+#endif //  _THERMALDERATING_H
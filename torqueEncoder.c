@@ -1,4 +1,3 @@
-#include <stdlib.h>  //Needed for malloc
 #include <math.h>
 #include "IO_RTC.h"
 
@@ -9,6 +8,8 @@
 extern Sensor Sensor_BenchTPS0;
 extern Sensor Sensor_BenchTPS1;
 
+static struct _TorqueEncoder torqueEncoderInstance;
+
 /*****************************************************************************
 * Torque Encoder (TPS) functions
 * RULE EV2.3.5:
@@ -17,7 +18,7 @@ extern Sensor Sensor_BenchTPS1;
 ****************************************************************************/
 TorqueEncoder* TorqueEncoder_new(bool benchMode)
 {
-    TorqueEncoder* me = (TorqueEncoder*) malloc(sizeof(struct _TorqueEncoder));
+    TorqueEncoder* me = &torqueEncoderInstance;
     //me->bench = benchMode;
 	
     //TODO: Make sure the main loop is running before doing this
@@ -62,6 +63,7 @@ TorqueEncoder* TorqueEncoder_new(bool benchMode)
     //me->tps1_calibMax = 4441;  //me->tps1->sensorValue;
 
     me->calibrated = TRUE;
+    me->updateCount = 0;
 
     return me;
 }
@@ -69,6 +71,12 @@ TorqueEncoder* TorqueEncoder_new(bool benchMode)
 //Updates all values based on sensor readings, safety checks, etc
 void TorqueEncoder_update(TorqueEncoder* me)
 {
+	//Calibration values change every cycle while calibrating, so count those as updates too
+	if (me->tps0_value != me->tps0->sensorValue || me->tps1_value != me->tps1->sensorValue || me->runCalibration == TRUE)
+	{
+		me->updateCount++;
+	}
+
 	me->tps0_value = me->tps0->sensorValue;
 	me->tps1_value = me->tps1->sensorValue;
 
@@ -106,6 +114,11 @@ void TorqueEncoder_update(TorqueEncoder* me)
 	}
 }
 
+ubyte2 TorqueEncoder_getUpdateCount(TorqueEncoder* me)
+{
+    return me->updateCount;
+}
+
 void TorqueEncoder_resetCalibration(TorqueEncoder* me)
 {
     me->calibrated = FALSE;
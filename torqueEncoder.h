@@ -33,6 +33,8 @@ typedef struct _TorqueEncoder
     bool calibrated;
     float4 percent;
 	bool implausibility;
+
+    ubyte2 updateCount;  //Incremented whenever values reported by this object change (for telemetry)
 } TorqueEncoder;
 
 TorqueEncoder* TorqueEncoder_new(bool benchMode);
@@ -45,5 +47,6 @@ void TorqueEncoder_startCalibration(TorqueEncoder* me, ubyte1 secondsToRun);
 void TorqueEncoder_calibrationCycle(TorqueEncoder* me, ubyte1* errorCount);
 //void TorqueEncoder_plausibilityCheck(TorqueEncoder* me, ubyte1* errorCount, bool* isPlausible);
 void TorqueEncoder_getPedalTravel(TorqueEncoder* me, ubyte1* errorCount, float4* pedalPercent);
+ubyte2 TorqueEncoder_getUpdateCount(TorqueEncoder* me);
 
 #endif //  _TORQUEENCODER_H
\ No newline at end of file
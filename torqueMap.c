@@ -0,0 +1,157 @@
+#include "IO_Driver.h"
+
+#include "torqueMap.h"
+
+#define TORQUEMAP_Q10_ONE 1024
+
+struct _TorqueMap
+{
+    TorqueMapTable tables[TORQUEMAP_MODE_COUNT];
+};
+
+static struct _TorqueMap torqueMapInstance;
+
+//Defaults: same shape the scalar regen settings used to give (see MCM_readTCSSettings).
+//Below the coasting point the pedal blends from zero-pedal regen up to 0 torque,
+//above it the pedal goes linearly to full torque.  Not speed dependent (yet).
+typedef struct
+{
+    sbyte2 coastingPedalQ10;   //Pedal position that gives 0 torque
+    sbyte2 zeroPedalRegenQ10;  //Regen at 0% pedal, fraction of max torque (positive)
+} TorqueMapDefault;
+
+static const TorqueMapDefault torqueMapDefaults[TORQUEMAP_MODE_COUNT] =
+{
+    {   0,   0 },  //0: Regen off
+    {   0,   0 },  //1: Coasting (Formula E) - regen on brake only
+    { 205, 154 },  //2: Light engine braking - coast at 20% pedal, 15% regen at 0%
+    { 102, 512 },  //3: One pedal (Tesla) - coast at 10% pedal, 50% regen at 0%
+    {   0,   0 },  //4: User customizable
+};
+
+static void TorqueMap_fillDefault(TorqueMap* me, ubyte1 mode)
+{
+    const TorqueMapDefault* d = &torqueMapDefaults[mode];
+
+    for (ubyte1 pedal = 0; pedal < TORQUEMAP_PEDAL_POINTS; pedal++)
+    {
+        sbyte4 pedalQ10 = (sbyte4)pedal << TORQUEMAP_PEDAL_SHIFT;
+        sbyte2 cell = (pedalQ10 < d->coastingPedalQ10)
+            ? (sbyte2)(-(sbyte4)d->zeroPedalRegenQ10 * (d->coastingPedalQ10 - pedalQ10) / d->coastingPedalQ10)
+            : (sbyte2)(TORQUEMAP_Q10_ONE * (pedalQ10 - d->coastingPedalQ10) / (TORQUEMAP_Q10_ONE - d->coastingPedalQ10));
+
+        for (ubyte1 speed = 0; speed < TORQUEMAP_SPEED_POINTS; speed++)
+        {
+            me->tables[mode][speed][pedal] = cell;
+        }
+    }
+}
+
+TorqueMap* TorqueMap_new(void)
+{
+    TorqueMap* me = &torqueMapInstance;
+
+    for (ubyte1 mode = 0; mode < TORQUEMAP_MODE_COUNT; mode++)
+    {
+        TorqueMap_fillDefault(me, mode);
+    }
+
+    return me;
+}
+
+bool TorqueMap_load(TorqueMap* me, ubyte1 mode, const TorqueMapTable table)
+{
+    if (mode >= TORQUEMAP_MODE_COUNT)
+    {
+        return FALSE;
+    }
+
+    //Check everything first so a bad table never gets half-loaded
+    for (ubyte1 speed = 0; speed < TORQUEMAP_SPEED_POINTS; speed++)
+    {
+        for (ubyte1 pedal = 0; pedal < TORQUEMAP_PEDAL_POINTS; pedal++)
+        {
+            if (table[speed][pedal] > TORQUEMAP_Q10_ONE || table[speed][pedal] < -TORQUEMAP_Q10_ONE)
+            {
+                return FALSE;
+            }
+            //Pedal released must never ask for drive torque
+            if (pedal == 0 && table[speed][pedal] > 0)
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    for (ubyte1 speed = 0; speed < TORQUEMAP_SPEED_POINTS; speed++)
+    {
+        for (ubyte1 pedal = 0; pedal < TORQUEMAP_PEDAL_POINTS; pedal++)
+        {
+            me->tables[mode][speed][pedal] = table[speed][pedal];
+        }
+    }
+    return TRUE;
+}
+
+/*****************************************************************************
+* Splits an axis value into a cell index and the position inside that cell
+* (0 to 2^shift).  Values past the end land on the last cell with a full
+* fraction, so the result is the last breakpoint.
+****************************************************************************/
+static ubyte1 TorqueMap_locate(ubyte2 value, ubyte1 shift, ubyte1 points, ubyte2* fraction)
+{
+    ubyte2 index = value >> shift;
+
+    if (index >= points - 1)
+    {
+        *fraction = (ubyte2)1 << shift;
+        return points - 2;
+    }
+    *fraction = value & (((ubyte2)1 << shift) - 1);
+    return (ubyte1)index;
+}
+
+sbyte2 TorqueMap_getTorqueDNm(TorqueMap* me, ubyte1 mode, float4 pedalPercent, sbyte2 motorRPM, sbyte2 torqueMaximumDNm)
+{
+    ubyte2 pedalQ10;
+    ubyte2 speed;
+    ubyte2 pedalFraction;
+    ubyte2 speedFraction;
+    ubyte1 p;
+    ubyte1 s;
+    sbyte4 low;
+    sbyte4 high;
+    sbyte4 torqueQ10;
+
+    if (mode >= TORQUEMAP_MODE_COUNT)
+    {
+        mode = 0;
+    }
+
+    //Only conversion out of float - everything after this is integer
+    pedalQ10 = (pedalPercent <= 0) ? 0
+             : (pedalPercent >= 1) ? TORQUEMAP_Q10_ONE
+             : (ubyte2)(pedalPercent * TORQUEMAP_Q10_ONE);
+    speed = (motorRPM < 0) ? 0 : (ubyte2)motorRPM;  //Reverse not allowed - treat as standing still
+
+    p = TorqueMap_locate(pedalQ10, TORQUEMAP_PEDAL_SHIFT, TORQUEMAP_PEDAL_POINTS, &pedalFraction);
+    s = TorqueMap_locate(speed, TORQUEMAP_SPEED_SHIFT, TORQUEMAP_SPEED_POINTS, &speedFraction);
+
+    //Interpolate along pedal at both neighboring speeds, then between them
+    low = me->tables[mode][s][p]
+        + (((sbyte4)me->tables[mode][s][p + 1] - me->tables[mode][s][p]) * pedalFraction >> TORQUEMAP_PEDAL_SHIFT);
+    high = me->tables[mode][s + 1][p]
+        + (((sbyte4)me->tables[mode][s + 1][p + 1] - me->tables[mode][s + 1][p]) * pedalFraction >> TORQUEMAP_PEDAL_SHIFT);
+    torqueQ10 = low + ((high - low) * speedFraction >> TORQUEMAP_SPEED_SHIFT);
+
+    return (sbyte2)((torqueQ10 * torqueMaximumDNm) >> 10);
+}
+
+sbyte2 TorqueMap_getCell(TorqueMap* me, ubyte1 mode, ubyte1 speed, ubyte1 pedal)
+{
+    if (mode >= TORQUEMAP_MODE_COUNT || speed >= TORQUEMAP_SPEED_POINTS || pedal >= TORQUEMAP_PEDAL_POINTS)
+    {
+        return 0;
+    }
+    return me->tables[mode][speed][pedal];
+}
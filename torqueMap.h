@@ -0,0 +1,49 @@
+#ifndef _TORQUEMAP_H
+#define _TORQUEMAP_H
+
+#include "IO_Driver.h"
+
+/*****************************************************************************
+* Torque Map
+******************************************************************************
+* Driver torque request as a 2D table over accelerator pedal position and
+* motor speed, one table per regen/drive mode (TCS knob position).
+*
+* Table cells are a fraction of the motor controller's max torque in Q10
+* (1024 = 100% of max, negative = regen).  Both axes are evenly spaced on
+* power-of-two steps so finding the cell is a shift, and the lookup is a
+* fixed-point bilinear interpolation - same cost every call, no floats after
+* the pedal is converted.
+*
+*   Pedal axis: 0-100% in 8 steps    (Q10 pedal >> TORQUEMAP_PEDAL_SHIFT)
+*   Speed axis: 0-8192 rpm in 8 steps (rpm >> TORQUEMAP_SPEED_SHIFT)
+*   Anything past the last breakpoint uses the last row/column.
+*
+* Tables start out as defaults matching the old scalar regen settings and
+* can be replaced per mode with TorqueMap_load (e.g. from EEPROM).
+****************************************************************************/
+
+#define TORQUEMAP_PEDAL_POINTS 9
+#define TORQUEMAP_SPEED_POINTS 9
+#define TORQUEMAP_PEDAL_SHIFT 7   //1024 / 8 = 128 per cell
+#define TORQUEMAP_SPEED_SHIFT 10  //1024 rpm per cell
+#define TORQUEMAP_MODE_COUNT 5    //Same numbering as MCM regen_mode (knob position)
+
+//[speed][pedal], Q10 fraction of max torque (-1024 to 1024)
+typedef sbyte2 TorqueMapTable[TORQUEMAP_SPEED_POINTS][TORQUEMAP_PEDAL_POINTS];
+
+typedef struct _TorqueMap TorqueMap;
+
+TorqueMap* TorqueMap_new(void);
+
+//Replaces one mode's table.  FALSE (and nothing changed) if the mode or any cell is out of range,
+//or any 0% pedal cell is positive.
+bool TorqueMap_load(TorqueMap* me, ubyte1 mode, const TorqueMapTable table);
+
+//Torque request in deciNewton-meters.  Unknown modes use mode 0 (regen off).
+sbyte2 TorqueMap_getTorqueDNm(TorqueMap* me, ubyte1 mode, float4 pedalPercent, sbyte2 motorRPM, sbyte2 torqueMaximumDNm);
+
+//One table cell (Q10), for reading the tables back.  0 if out of range.
+sbyte2 TorqueMap_getCell(TorqueMap* me, ubyte1 mode, ubyte1 speed, ubyte1 pedal);
+
+#endif //  _TORQUEMAP_H
@@ -1,4 +1,3 @@
-#include <stdlib.h>  //Needed for malloc
 #include <math.h>
 #include "IO_RTC.h"
 #include "IO_DIO.h"
@@ -28,10 +27,13 @@ struct _WheelSpeeds
 	float4 speed_FR;
 	float4 speed_RL;
 	float4 speed_RR;
+	ubyte2 updateCount;  //Incremented whenever any wheel speed changes (for telemetry)
 };
 
 
 
+static struct _WheelSpeeds wheelSpeedsInstance;
+
 /*****************************************************************************
 * Torque Encoder (TPS) functions
 * RULE EV2.3.5:
@@ -40,7 +42,7 @@ struct _WheelSpeeds
 ****************************************************************************/
 WheelSpeeds* WheelSpeeds_new(float4 tireDiameterInches_F, float4 tireDiameterInches_R, ubyte1 pulsesPerRotation_F, ubyte1 pulsesPerRotation_R)
 {
-	WheelSpeeds* me = (WheelSpeeds*)malloc(sizeof(struct _WheelSpeeds));
+	WheelSpeeds* me = &wheelSpeedsInstance;
     
 	//1 inch = .0254 m
 	me->tireCircumferenceMeters_F = 3.14159 * (.0254 * tireDiameterInches_F);
@@ -51,6 +53,7 @@ WheelSpeeds* WheelSpeeds_new(float4 tireDiameterInches_F, float4 tireDiameterInc
 	me->speed_FR = 0;
 	me->speed_RL = 0;
 	me->speed_RR = 0;
+	me->updateCount = 0;
 
 	//Turn on WSS power pins
 	IO_DO_Set(IO_DO_06, TRUE); //Front WSS x2
@@ -61,11 +64,21 @@ WheelSpeeds* WheelSpeeds_new(float4 tireDiameterInches_F, float4 tireDiameterInc
 
 void WheelSpeeds_update(WheelSpeeds* me)
 {
+	float4 lastSpeed_FL = me->speed_FL;
+	float4 lastSpeed_FR = me->speed_FR;
+	float4 lastSpeed_RL = me->speed_RL;
+	float4 lastSpeed_RR = me->speed_RR;
+
 	//speed (m/s) = m * pulses/sec / pulses
 	me->speed_FL = me->tireCircumferenceMeters_F * Sensor_WSS_FL.sensorValue / me->pulsesPerRotation_F;
 	me->speed_FR = me->tireCircumferenceMeters_F * Sensor_WSS_FR.sensorValue / me->pulsesPerRotation_F;
 	me->speed_RL = me->tireCircumferenceMeters_R * Sensor_WSS_RL.sensorValue / me->pulsesPerRotation_R;
 	me->speed_RR = me->tireCircumferenceMeters_R * Sensor_WSS_RR.sensorValue / me->pulsesPerRotation_R;
+
+	if (me->speed_FL != lastSpeed_FL || me->speed_FR != lastSpeed_FR || me->speed_RL != lastSpeed_RL || me->speed_RR != lastSpeed_RR)
+	{
+		me->updateCount++;
+	}
 }
 
 float4 WheelSpeeds_getWheelSpeed(WheelSpeeds* me, Wheel corner)
@@ -106,3 +119,18 @@ float4 WheelSpeeds_getGroundSpeed(WheelSpeeds* me)
 {
 	return (me->speed_FL + me->speed_FR) / 2;
 }
+
+//Ground speed for regen decisions, km/h.  Under regen the driven (rear) wheels slow
+//down first, and a front wheel can lock or its sensor can drop out - all of which
+//read low.  Taking the faster of the front average and the motor-derived speed
+//ignores any one of those.
+float4 WheelSpeeds_getFusedGroundSpeedKPH(WheelSpeeds* me, float4 motorGroundSpeedKPH)
+{
+	float4 frontKPH = WheelSpeeds_getGroundSpeed(me) * 3.6;  //m/s -> km/h
+	return (frontKPH > motorGroundSpeedKPH) ? frontKPH : motorGroundSpeedKPH;
+}
+
+ubyte2 WheelSpeeds_getUpdateCount(WheelSpeeds* me)
+{
+	return me->updateCount;
+}
@@ -16,6 +16,8 @@ void WheelSpeeds_update(WheelSpeeds* me);
 float4 WheelSpeeds_getWheelSpeed(WheelSpeeds* me, Wheel corner);
 float4 WheelSpeeds_getSlowestFront(WheelSpeeds* me);
 float4 WheelSpeeds_getFastestRear(WheelSpeeds* me);
-float4 WheelSpeeds_getGroundSpeed(WheelSpeeds* me);
+float4 WheelSpeeds_getGroundSpeed(WheelSpeeds* me);  //m/s, front average
+float4 WheelSpeeds_getFusedGroundSpeedKPH(WheelSpeeds* me, float4 motorGroundSpeedKPH);
+ubyte2 WheelSpeeds_getUpdateCount(WheelSpeeds* me);
 
 #endif //  _BRAKEPRESSURESENSOR_H
\ No newline at end of file